@@ -94,14 +94,17 @@ namespace sakuraE::IR {
             }
         }
 
-        return curFunc()
+        auto call = static_cast<Instruction*>(curFunc()
             ->curBlock()
             ->createInstruction(
                 OpKind::call,
                 retType,
                 args,
                 "call." + addr->getName()
-            );
+            ));
+        call->setInfo(node->getPosInfo());
+
+        return call;
     }
 
     IRValue* IRGenerator::visitCallingOpNode(IRValue* addr, NodePtr node) {
@@ -415,18 +418,38 @@ namespace sakuraE::IR {
         if (node->hasNode(ASTTag::Ops)) {
             auto opChain = (*node)[ASTTag::Ops]->getChildren();
 
+            // 连续的字符串 + 先收集起来，最后合并成一次拼接，不产生中间字符串
+            std::vector<IRValue*> stringParts;
+            PositionInfo concatInfo = node->getPosInfo();
+            auto flushStringParts = [&]() {
+                if (stringParts.empty()) return;
+                lhs = createStringConcat(stringParts, concatInfo);
+                stringParts.clear();
+            };
+
             for (std::size_t i = 1; i < chain.size(); i ++) {
                 IRValue* rhs = visitMulExprNode(chain[i]);
 
                 switch (opChain[i - 1]->getToken().type)
                 {
                     case TokenType::ADD: {
+                        // 两个字符串相加即拼接
+                        if (lhs->getType()->isString() && rhs->getType()->isString()) {
+                            if (stringParts.empty()) {
+                                stringParts.push_back(lhs);
+                                concatInfo = opChain[i - 1]->getToken().info;
+                            }
+                            stringParts.push_back(rhs);
+                            break;
+                        }
+                        flushStringParts();
                         lhs = curFunc()
                                 ->curBlock()
                                 ->createInstruction(OpKind::add, handleUnlogicalBinaryCalc(lhs, rhs), {lhs, rhs}, "add");
                         break;
                     }
                     case TokenType::SUB: {
+                        flushStringParts();
                         lhs = curFunc()
                                 ->curBlock()
                                 ->createInstruction(OpKind::sub, handleUnlogicalBinaryCalc(lhs, rhs), {lhs, rhs}, "sub");
@@ -436,6 +459,8 @@ namespace sakuraE::IR {
                         break;
                 }
             }
+
+            flushStringParts();
         }
 
         return lhs;
@@ -619,6 +644,11 @@ namespace sakuraE::IR {
             }
             case TokenType::ADD_ASSIGN: {
                 resultValue = createLoad(resultAddr, op.info);
+                if (resultValue->getType()->isString() && value->getType()->isString()) {
+                    resultValue = createRuntimeCall("concat_string", {resultValue, value}, op.info);
+                    resultValue = createStore(resultAddr, resultValue, op.info);
+                    break;
+                }
                 resultValue = curFunc()
                     ->curBlock()
                     ->createInstruction(
@@ -737,8 +767,13 @@ namespace sakuraE::IR {
         if (node->hasNode(ASTTag::IdentifierExprNode)) {
             return visitIdentifierExprNode((*node)[ASTTag::IdentifierExprNode]);
         }
-        else
-            return visitAssignExprNode((*node)[ASTTag::AssignExprNode]);
+        else {
+            auto assign = (*node)[ASTTag::AssignExprNode];
+            if (auto appended = visitStringBuilderAppend(assign)) {
+                return appended;
+            }
+            return visitAssignExprNode(assign);
+        }
     }
 
     IRValue* IRGenerator::visitBlockStmtNode(NodePtr node, fzlib::String blockName, long beforeBlock) {
@@ -820,6 +855,7 @@ namespace sakuraE::IR {
 
 
     IRValue* IRGenerator::visitWhileStmtNode(NodePtr node) {
+        auto builderSlots = beginStringBuilders({(*node)[ASTTag::Condition], (*node)[ASTTag::Block]}, node->getPosInfo());
         int beforeBlockIndex = curFunc()->cur();
 
         // while.prep
@@ -861,6 +897,7 @@ namespace sakuraE::IR {
         //
         curFunc()->leaveLoop();
         curFunc()->moveCursor(mergeBlockIndex);
+        endStringBuilders(builderSlots, node->getPosInfo());
         return mergeBlock;
     }
 
@@ -871,6 +908,10 @@ namespace sakuraE::IR {
         if (node->hasNode(ASTTag::DeclareStmtNode)) {
             visitDeclareStmtNode((*node)[ASTTag::DeclareStmtNode]);
         }
+
+        std::vector<NodePtr> loopParts = {(*node)[ASTTag::Condition], (*node)[ASTTag::Block], (*node)[ASTTag::HeadExpr]};
+        if (node->hasNode(ASTTag::DeclareStmtNode)) loopParts.push_back((*node)[ASTTag::DeclareStmtNode]);
+        auto builderSlots = beginStringBuilders(loopParts, node->getPosInfo());
         int initExitIndex = curFunc()->cur();
 
         // for.cond
@@ -924,12 +965,14 @@ namespace sakuraE::IR {
         curFunc()->leaveLoop();
         curFunc()->fnScope().leave();
         curFunc()->moveCursor(mergeBlockIndex);
+        endStringBuilders(builderSlots, node->getPosInfo());
         return mergeBlock;
     }
 
     IRValue* IRGenerator::visitRepeatStmtNode(NodePtr node) {
         curFunc()->fnScope().enter();
 
+        auto builderSlots = beginStringBuilders({(*node)[ASTTag::HeadExpr], (*node)[ASTTag::Block]}, node->getPosInfo());
         int beforeBlockIndex = curFunc()->cur();
 
         // repeat.prepare
@@ -1013,6 +1056,7 @@ namespace sakuraE::IR {
         curFunc()->leaveLoop();
         curFunc()->fnScope().leave();
         curFunc()->moveCursor(mergeBlockIndex);
+        endStringBuilders(builderSlots, node->getPosInfo());
 
         return mergeBlock;
     }
@@ -1161,7 +1205,10 @@ namespace sakuraE::IR {
 
         curFunc()->setFuncDefineInfo(params, retType);
 
+        NodePtr outerFuncBody = curFuncBody;
+        curFuncBody = (*node)[ASTTag::Block];
         visitBlockStmtNode((*node)[ASTTag::Block], "fn." + fnName, initBlockIndex);
+        curFuncBody = outerFuncBody;
 
         return fn;
     };
@@ -17,6 +17,7 @@
 #include "Compiler/Frontend/lexer.h"
 
 #include <algorithm>
+#include <map>
 #include <numbers>
 
 
@@ -85,6 +86,12 @@ namespace sakuraE::IR {
                     }
                 }
 
+                // 字符串字面量是只读的常量对象，按下标写入前先把字符串换成堆上的副本，再对副本重新取下标。
+                // 复合赋值已经通过原来的下标读过一次，字面量与副本内容相同，不影响结果。
+                if (inst->getKind() == OpKind::indexing && isStringOrRefToString(inst->arg(0)->getType())) {
+                    addr = createMutableStringIndexing(inst, info);
+                }
+
                 return curFunc()
                             ->curBlock()
                             ->createInstruction(OpKind::store,
@@ -99,6 +106,40 @@ namespace sakuraE::IR {
             }
         }
 
+        static bool isStringOrRefToString(IRType* ty) {
+            return ty->isString() || (ty->isRef() && static_cast<IRRefType*>(ty)->getElementType()->isString());
+        }
+
+        IRValue* createMutableStringIndexing(Instruction* indexing, PositionInfo info) {
+            IRValue* base = indexing->arg(0);
+
+            auto baseInst = dynamic_cast<Instruction*>(base);
+            if (base->getType()->isRef()) {
+                // 通过 ref 写入：先解引用得到被引用的字符串变量，把副本写回那里，再对它重新取下标。
+                IRValue* ref = baseInst && baseInst->isLValue() ? createLoad(base, info) : base;
+                base = curFunc()
+                    ->curBlock()
+                    ->createInstruction(OpKind::deref,
+                                        static_cast<IRRefType*>(ref->getType())->getElementType(),
+                                        {ref},
+                                        "deref." + ref->getName());
+                createStore(base, createRuntimeCall("string_make_mutable", {createLoad(base, info)}, info), info);
+            }
+            else if (baseInst && baseInst->isLValue()) {
+                createStore(base, createRuntimeCall("string_make_mutable", {createLoad(base, info)}, info), info);
+            }
+            else {
+                base = createRuntimeCall("string_make_mutable", {base}, info);
+            }
+
+            return curFunc()
+                ->curBlock()
+                ->createInstruction(OpKind::indexing,
+                                    indexing->getType(),
+                                    {base, indexing->arg(1)},
+                                    "indexing." + base->getName());
+        }
+
         IRValue* createParam(fzlib::String name, IRType* ty, PositionInfo info) {
             IRType* finalType = ty;
 
@@ -322,6 +363,310 @@ namespace sakuraE::IR {
             throw SakuraError(OccurredTerm::IR_GENERATING, "Internal error: unhandled type rank", info);
         }
 
+        // 直接调用运行时模块里的函数，不经过用户作用域，用户定义的同名函数不会截走编译器生成的调用。
+        IRValue* createRuntimeCall(fzlib::String n, std::vector<IRValue*> args, PositionInfo info) {
+            std::vector<IRType*> argTypes;
+            for (auto arg: args) {
+                argTypes.push_back(arg->getType());
+            }
+
+            auto symbol = program.mod(0)->lookup(mangleFnName(n, argTypes));
+            if (!symbol) {
+                throw SakuraError(OccurredTerm::IR_GENERATING,
+                        "Internal error: unknown runtime function: " + n,
+                        info);
+            }
+
+            auto fn = static_cast<Function*>(symbol->address);
+            auto call = static_cast<Instruction*>(curFunc()
+                ->curBlock()
+                ->createInstruction(
+                    OpKind::call,
+                    fn->getReturnType(),
+                    args,
+                    "call." + fn->getName()
+                ));
+            call->setInfo(info);
+
+            return call;
+        }
+
+        // 拼接一串字符串：两段直接调用 concat_string，更多段合并成一条 concat_n，只分配一次，也没有中间结果
+        IRValue* createStringConcat(std::vector<IRValue*> parts, PositionInfo info) {
+            if (parts.size() == 2) {
+                return createRuntimeCall("concat_string", parts, info);
+            }
+
+            auto concat = static_cast<Instruction*>(curFunc()
+                ->curBlock()
+                ->createInstruction(OpKind::concat_n, IRType::getStringTy(), parts, "concat_n"));
+            concat->setInfo(info);
+
+            return concat;
+        }
+
+        // 用户代码里的 n（已经按参数类型 mangle）是否就是运行时模块里的那个函数
+        bool resolvesToRuntimeFunction(fzlib::String n) {
+            auto symbol = curFunc()->fnScope().lookup(n);
+            if (!symbol) symbol = curModule()->lookup(n);
+            auto runtimeSymbol = program.mod(0)->lookup(n);
+
+            return symbol && runtimeSymbol && symbol->address == runtimeSymbol->address;
+        }
+
+        // --- String builder ---
+        // 循环里只做追加的字符串变量会在进入循环前换成一个 string builder，循环结束时再生成字符串写回变量，
+        // 避免每轮拼接都复制一遍整个前缀。这里记录当前生效的替换：变量槽位 -> builder 槽位。
+        std::map<IRValue*, IRValue*> stringBuilderSlots;
+        // 正在生成的函数的函数体，逃逸检查要看整个函数里有没有对变量取地址
+        NodePtr curFuncBody = nullptr;
+
+        static bool hasOps(NodePtr node) {
+            return node->hasNode(ASTTag::Ops) && !(*node)[ASTTag::Ops]->getChildren().empty();
+        }
+
+        // 只有一个子表达式且没有运算符时返回它，否则返回 nullptr
+        static NodePtr soleExpr(NodePtr node) {
+            if (!node->hasNode(ASTTag::Exprs) || hasOps(node)) return nullptr;
+
+            auto chain = (*node)[ASTTag::Exprs]->getChildren();
+            return chain.size() == 1 ? chain[0] : nullptr;
+        }
+
+        // IdentifierExprNode 是不带任何运算的单个变量名时返回该名字，否则返回空串
+        static fzlib::String plainIdentifierName(NodePtr node) {
+            if (node->getTag() != ASTTag::IdentifierExprNode ||
+                node->hasNode(ASTTag::PreOp) || node->hasNode(ASTTag::Op)) return "";
+
+            auto atom = soleExpr(node);
+            if (!atom || !atom->hasNode(ASTTag::Identifier) || hasOps(atom)) return "";
+
+            return (*atom)[ASTTag::Identifier]->getToken().content;
+        }
+
+        // 去掉没有运算符的 Binary / Logic 外壳，取出 WholeExprNode 里的 AddExprNode
+        static NodePtr addExprOf(NodePtr whole) {
+            if (whole->hasNode(ASTTag::AddExprNode)) return (*whole)[ASTTag::AddExprNode];
+            if (!whole->hasNode(ASTTag::BinaryExprNode)) return nullptr;
+
+            auto logic = soleExpr((*whole)[ASTTag::BinaryExprNode]);
+            return logic ? soleExpr(logic) : nullptr;
+        }
+
+        // MulExprNode 只是一个标识符表达式时返回它
+        static NodePtr identifierExprOf(NodePtr mul) {
+            auto prim = soleExpr(mul);
+            if (!prim || !prim->hasNode(ASTTag::Identifier)) return nullptr;
+
+            return (*prim)[ASTTag::Identifier];
+        }
+
+        // 识别对字符串变量的追加赋值，得到变量名和依次追加的操作数（MulExprNode 或 WholeExprNode）：
+        //   s += e
+        //   s = s + e1 + e2 ...
+        //   s = concat_string(s, e)
+        bool matchStringAppend(NodePtr assign, fzlib::String& name, std::vector<NodePtr>& operands) {
+            if (!assign->hasNode(ASTTag::Identifier) || !assign->hasNode(ASTTag::HeadExpr)) return false;
+
+            name = plainIdentifierName((*assign)[ASTTag::Identifier]);
+            if (name.len() == 0) return false;
+
+            auto head = (*assign)[ASTTag::HeadExpr];
+            switch ((*assign)[ASTTag::Op]->getToken().type) {
+                case TokenType::ADD_ASSIGN: {
+                    operands = {head};
+                    return true;
+                }
+                case TokenType::ASSIGN_OP: {
+                    auto add = addExprOf(head);
+                    if (!add) return false;
+
+                    auto chain = (*add)[ASTTag::Exprs]->getChildren();
+                    if (chain.size() > 1) {
+                        for (auto op: (*add)[ASTTag::Ops]->getChildren()) {
+                            if (op->getToken().type != TokenType::ADD) return false;
+                        }
+
+                        auto first = identifierExprOf(chain[0]);
+                        if (!first || plainIdentifierName(first) != name) return false;
+
+                        operands.assign(chain.begin() + 1, chain.end());
+                        return true;
+                    }
+
+                    auto callee = identifierExprOf(chain[0]);
+                    if (!callee || callee->hasNode(ASTTag::PreOp) || callee->hasNode(ASTTag::Op)) return false;
+
+                    auto atom = soleExpr(callee);
+                    if (!atom || !atom->hasNode(ASTTag::Identifier) || !atom->hasNode(ASTTag::Ops)) return false;
+                    if ((*atom)[ASTTag::Identifier]->getToken().content != "concat_string") return false;
+                    if (!resolvesToRuntimeFunction("concat_string_string_string")) return false;
+
+                    auto ops = (*atom)[ASTTag::Ops]->getChildren();
+                    if (ops.size() != 1 || ops[0]->getTag() != ASTTag::CallingOpNode) return false;
+
+                    auto args = (*ops[0])[ASTTag::Exprs]->getChildren();
+                    if (args.size() != 2) return false;
+
+                    auto firstAdd = addExprOf(args[0]);
+                    auto firstMul = firstAdd ? soleExpr(firstAdd) : nullptr;
+                    auto first = firstMul ? identifierExprOf(firstMul) : nullptr;
+                    if (!first || plainIdentifierName(first) != name) return false;
+
+                    operands = {args[1]};
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        // 收集 node 里作为语句出现的追加赋值的目标变量名
+        void collectStringAppendTargets(NodePtr node, std::vector<fzlib::String>& names) {
+            if (node->isLeaf()) return;
+
+            if (node->getTag() == ASTTag::ExprStmtNode && node->hasNode(ASTTag::AssignExprNode)) {
+                fzlib::String name;
+                std::vector<NodePtr> operands;
+                if (matchStringAppend((*node)[ASTTag::AssignExprNode], name, operands) &&
+                    std::find(names.begin(), names.end(), name) == names.end()) {
+                    names.push_back(name);
+                }
+            }
+
+            for (auto child: node->getChildren()) {
+                collectStringAppendTargets(child, names);
+            }
+        }
+
+        // 检查 name 在 node 里是否只出现在追加赋值语句的左边：其余任何出现（读取、取地址、重新声明……）都置位 escaped
+        void scanStringAppends(NodePtr node, const fzlib::String& name, bool& escaped) {
+            if (escaped) return;
+
+            if (node->isLeaf()) {
+                auto tok = node->getToken();
+                if (tok.type == TokenType::IDENTIFIER && tok.content == name) escaped = true;
+                return;
+            }
+
+            if (node->getTag() == ASTTag::ExprStmtNode && node->hasNode(ASTTag::AssignExprNode)) {
+                fzlib::String target;
+                std::vector<NodePtr> operands;
+                if (matchStringAppend((*node)[ASTTag::AssignExprNode], target, operands) && target == name) {
+                    for (auto operand: operands) {
+                        scanStringAppends(operand, name, escaped);
+                    }
+                    return;
+                }
+            }
+
+            for (auto child: node->getChildren()) {
+                scanStringAppends(child, name, escaped);
+            }
+        }
+
+        // node 里是否有对 name 取地址（&name）或取引用（ref name）的表达式
+        static bool takesAddressOf(NodePtr node, const fzlib::String& name) {
+            if (node->isLeaf()) return false;
+
+            if (node->getTag() == ASTTag::IdentifierExprNode && node->hasNode(ASTTag::PreOp)) {
+                auto op = (*node)[ASTTag::PreOp]->getToken().type;
+                auto atom = soleExpr(node);
+                if ((op == TokenType::AND || op == TokenType::KEYWORD_REF) &&
+                    atom && atom->hasNode(ASTTag::Identifier) && (*atom)[ASTTag::Identifier]->getToken().content == name) return true;
+            }
+
+            for (auto child: node->getChildren()) {
+                if (takesAddressOf(child, name)) return true;
+            }
+            return false;
+        }
+
+        // 变量是否可能通过指针或引用被访问：已经生成的代码里有引用这个槽位的 gaddr，
+        // 或者函数体任何位置（包括循环之后、还没生成的部分）对这个名字用了 & / ref。
+        // 这样的变量在循环里会被别名读到旧值，别名的写入也会被循环出口的写回覆盖，不能换成 builder。
+        bool stringSlotAliased(Instruction* slot, const fzlib::String& name) {
+            for (auto block: curFunc()->getBlocks()) {
+                for (auto ins: block->getInstructions()) {
+                    if (ins->getKind() == OpKind::gaddr && ins->arg(0) == slot) return true;
+                }
+            }
+
+            return curFuncBody && takesAddressOf(curFuncBody, name);
+        }
+
+        // 在循环开始之前调用：把循环里只做追加的本函数字符串变量换成 builder，返回这次替换的变量槽位。
+        // 外层循环已经替换过的变量保持不动，内层的追加直接写外层的 builder。
+        std::vector<IRValue*> beginStringBuilders(std::vector<NodePtr> loopParts, PositionInfo info) {
+            std::vector<fzlib::String> names;
+            for (auto part: loopParts) {
+                collectStringAppendTargets(part, names);
+            }
+
+            std::vector<IRValue*> slots;
+            for (auto name: names) {
+                auto symbol = curFunc()->fnScope().lookup(name);
+                if (!symbol) continue;
+
+                auto slot = dynamic_cast<Instruction*>(symbol->address);
+                if (!slot || slot->getKind() != OpKind::create_alloca || !slot->getType()->isString() ||
+                    slot->getParent()->getParent() != curFunc() || stringBuilderSlots.contains(slot)) continue;
+
+                bool escaped = stringSlotAliased(slot, name);
+                for (auto part: loopParts) {
+                    scanStringAppends(part, name, escaped);
+                }
+                if (escaped) continue;
+
+                auto builder = createRuntimeCall("string_builder_new", {createLoad(slot, info)}, info);
+                stringBuilderSlots[slot] = createAlloca("$string_builder." + name, IRType::getStringBuilderTy(), builder, info);
+                slots.push_back(slot);
+            }
+
+            return slots;
+        }
+
+        // 在循环出口（merge block 开头）调用：生成字符串写回变量，撤销替换
+        void endStringBuilders(const std::vector<IRValue*>& slots, PositionInfo info) {
+            for (auto slot: slots) {
+                auto builderSlot = stringBuilderSlots[slot];
+                auto result = createRuntimeCall("string_builder_finish", {createLoad(builderSlot, info)}, info);
+                createStore(slot, result, info);
+                stringBuilderSlots.erase(slot);
+            }
+        }
+
+        // 对已经换成 builder 的变量，把追加赋值语句改写成 string_builder_append；不适用时返回 nullptr
+        IRValue* visitStringBuilderAppend(NodePtr assign) {
+            if (stringBuilderSlots.empty()) return nullptr;
+
+            fzlib::String name;
+            std::vector<NodePtr> operands;
+            if (!matchStringAppend(assign, name, operands)) return nullptr;
+
+            auto symbol = curFunc()->fnScope().lookup(name);
+            if (!symbol || !stringBuilderSlots.contains(symbol->address)) return nullptr;
+
+            auto builderSlot = stringBuilderSlots[symbol->address];
+            auto info = assign->getPosInfo();
+            IRValue* result = nullptr;
+            for (auto operand: operands) {
+                IRValue* value = operand->getTag() == ASTTag::MulExprNode
+                                    ? visitMulExprNode(operand)
+                                    : visitWholeExprNode(operand);
+                if (!value->getType()->isString()) {
+                    throw SakuraError(OccurredTerm::IR_GENERATING,
+                            "Cannot append a value of type '" + value->getType()->toString() + "' to string '" + name + "'",
+                            operand->getPosInfo());
+                }
+
+                auto builder = createRuntimeCall("string_builder_append", {createLoad(builderSlot, info), value}, info);
+                result = createStore(builderSlot, builder, info);
+            }
+
+            return result;
+        }
+
         Function* curFunc() {
             return program.curMod()->curFunc();
         }
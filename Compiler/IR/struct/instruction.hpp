@@ -24,6 +24,8 @@ namespace sakuraE::IR {
         create_array,
         indexing,
         call,
+        // Concatenate all operands (strings) with one allocation
+        concat_n,
         load,
         gmem,
         gaddr,
@@ -44,6 +46,8 @@ namespace sakuraE::IR {
         std::vector<IRValue*> args;
 
         Block* parent = nullptr;
+        // 目前只有 call 与 concat_n 会记录源码位置，供 codegen 发射分配点描述符
+        PositionInfo createInfo;
     public:
         Instruction(OpKind k, IRType* t): IRValue(t), kind(k) {}
         Instruction(OpKind k, IRType* t, std::vector<IRValue*> params):
@@ -67,6 +71,7 @@ namespace sakuraE::IR {
             return kind == OpKind::constant ||
                     kind == OpKind::create_array ||
                     kind == OpKind::call ||
+                    kind == OpKind::concat_n ||
                     kind == OpKind::add ||
                     kind == OpKind::sub ||
                     kind == OpKind::mul ||
@@ -90,6 +95,14 @@ namespace sakuraE::IR {
             return parent;
         }
 
+        void setInfo(const PositionInfo& info) {
+            createInfo = info;
+        }
+
+        const PositionInfo& getInfo() const {
+            return createInfo;
+        }
+
         const std::vector<IRValue*>& getOperands() {
             return args;
         }
@@ -57,6 +57,191 @@ namespace sakuraE::IR {
                 info
             );
 
+            // 带分配点描述符的版本，由 codegen 发射，堆 profiler 据此把分配归到源码位置。
+            runtimeMod->declareRuntimeFunction(
+                "__create_string", 
+                IRType::getStringTy(), 
+                { 
+                    {"literal", IRType::getPointerTo(IRType::getCharTy())}, 
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())} 
+                }, 
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__concat_string", 
+                IRType::getStringTy(), 
+                { 
+                    {"s1", IRType::getStringTy()}, 
+                    {"s2", IRType::getStringTy()}, 
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())} 
+                }, 
+                info
+            );
+
+            // 字符串字面量是只读的常量对象，按下标写入字符串之前先换成堆上的副本。
+            runtimeMod->declareRuntimeFunction(
+                "string_make_mutable",
+                IRType::getStringTy(),
+                { {"str", IRType::getStringTy()} },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__string_make_mutable",
+                IRType::getStringTy(),
+                {
+                    {"str", IRType::getStringTy()},
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())}
+                },
+                info
+            );
+
+            // 连续的字符串 + 合并成的 concat_n 指令由 codegen 直接降级为这个调用，parts 指向栈上的指针数组。
+            runtimeMod->declareRuntimeFunction(
+                "__concat_n",
+                IRType::getStringTy(),
+                {
+                    {"count", IRType::getUInt32Ty()},
+                    {"parts", IRType::getPointerTo(IRType::getVoidTy())},
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())}
+                },
+                info
+            );
+
+            // string builder：生成器把循环里只做追加的字符串变量改写成这三个调用，
+            // codegen 再像 concat_string 一样改调带分配点的 __ 版本。
+            runtimeMod->declareRuntimeFunction(
+                "string_builder_new",
+                IRType::getStringBuilderTy(),
+                { {"initial", IRType::getStringTy()} },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "string_builder_append",
+                IRType::getStringBuilderTy(),
+                {
+                    {"builder", IRType::getStringBuilderTy()},
+                    {"str", IRType::getStringTy()}
+                },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "string_builder_finish",
+                IRType::getStringTy(),
+                { {"builder", IRType::getStringBuilderTy()} },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__string_builder_new",
+                IRType::getStringBuilderTy(),
+                {
+                    {"initial", IRType::getStringTy()},
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())}
+                },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__string_builder_append",
+                IRType::getStringBuilderTy(),
+                {
+                    {"builder", IRType::getStringBuilderTy()},
+                    {"str", IRType::getStringTy()},
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())}
+                },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__string_builder_finish",
+                IRType::getStringTy(),
+                {
+                    {"builder", IRType::getStringBuilderTy()},
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())}
+                },
+                info
+            );
+
+            // 字符串内核：程序里按不带 __ 的名字调用，codegen 改调运行时的 __ 版本。
+            // 不分配的内核两个版本参数相同，会分配的版本多一个分配点参数。
+            auto declareStringKernel = [&](fzlib::String name, IRType* retType, FormalParamsDefine params) {
+                runtimeMod->declareRuntimeFunction(name, retType, params, info);
+                runtimeMod->declareRuntimeFunction("__" + name, retType, params, info);
+            };
+
+            declareStringKernel("string_length", IRType::getInt64Ty(), { {"str", IRType::getStringTy()} });
+            declareStringKernel(
+                "string_equal",
+                IRType::getBoolTy(),
+                {
+                    {"lhs", IRType::getStringTy()},
+                    {"rhs", IRType::getStringTy()}
+                }
+            );
+            declareStringKernel(
+                "string_compare",
+                IRType::getInt32Ty(),
+                {
+                    {"lhs", IRType::getStringTy()},
+                    {"rhs", IRType::getStringTy()}
+                }
+            );
+            declareStringKernel(
+                "string_find",
+                IRType::getInt64Ty(),
+                {
+                    {"str", IRType::getStringTy()},
+                    {"needle", IRType::getStringTy()}
+                }
+            );
+            declareStringKernel(
+                "string_find_char",
+                IRType::getInt64Ty(),
+                {
+                    {"str", IRType::getStringTy()},
+                    {"ch", IRType::getCharTy()}
+                }
+            );
+            declareStringKernel("string_hash", IRType::getUInt64Ty(), { {"str", IRType::getStringTy()} });
+
+            runtimeMod->declareRuntimeFunction(
+                "string_to_lower",
+                IRType::getStringTy(),
+                { {"str", IRType::getStringTy()} },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "string_to_upper",
+                IRType::getStringTy(),
+                { {"str", IRType::getStringTy()} },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__string_to_lower",
+                IRType::getStringTy(),
+                {
+                    {"str", IRType::getStringTy()},
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())}
+                },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__string_to_upper",
+                IRType::getStringTy(),
+                {
+                    {"str", IRType::getStringTy()},
+                    {"site", IRType::getPointerTo(IRType::getVoidTy())}
+                },
+                info
+            );
+
             runtimeMod->declareRuntimeFunction(
                 "__print", 
                 IRType::getVoidTy(), 
@@ -78,7 +263,18 @@ namespace sakuraE::IR {
                 {
                     { "size", IRType::getUIntNTy(targetSize) },
                     { "ty", IRType::getPointerTo(IRType::getVoidTy()) },
-                    { "member_count", IRType::getUInt64Ty() }
+                    { "site", IRType::getPointerTo(IRType::getVoidTy()) }
+                }, 
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__gc_alloc_uninit", 
+                IRType::getPointerTo(IRType::getVoidTy()), 
+                {
+                    { "size", IRType::getUIntNTy(targetSize) },
+                    { "ty", IRType::getPointerTo(IRType::getVoidTy()) },
+                    { "site", IRType::getPointerTo(IRType::getVoidTy()) }
                 }, 
                 info
             );
@@ -118,6 +314,30 @@ namespace sakuraE::IR {
                 info
             );
 
+            runtimeMod->declareRuntimeFunction(
+                "__gc_write_barrier",
+                IRType::getVoidTy(),
+                {
+                    { "slot", IRType::getPointerTo(IRType::getPointerTo(IRType::getVoidTy())) },
+                    { "value", IRType::getPointerTo(IRType::getVoidTy()) }
+                },
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__gc_safe_point",
+                IRType::getVoidTy(),
+                {},
+                info
+            );
+
+            runtimeMod->declareRuntimeFunction(
+                "__gc_current_thread",
+                IRType::getPointerTo(IRType::getVoidTy()),
+                {},
+                info
+            );
+
             runtimeMod->declareRuntimeFunction(
                 "__gc_get_struct_type",
                 IRType::getPointerTo(IRType::getVoidTy()),
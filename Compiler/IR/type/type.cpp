@@ -53,6 +53,7 @@ namespace sakuraE::IR {
             case BoolTyID:
             case TypeInfoTyID:
             case StringTyID:
+            case StringBuilderTyID:
             case Float32TyID:
             case Float64TyID:
             case VoidTyID:
@@ -152,6 +153,11 @@ namespace sakuraE::IR {
         return &stringSingle;
     }
 
+    IRType* IRType::getStringBuilderTy() {
+        static IRStringBuilderType stringBuilderSingle;
+        return &stringBuilderSingle;
+    }
+
     IRType* IRType::getFloat32Ty() {
         static IRFloatType float32Single(32);
         return &float32Single;
@@ -232,6 +238,10 @@ namespace sakuraE::IR {
         return llvm::PointerType::getUnqual(ctx);
     }
 
+    llvm::Type* IRStringBuilderType::toLLVMType(llvm::LLVMContext& ctx) {
+        return llvm::PointerType::getUnqual(ctx);
+    }
+
     llvm::Type* IRRefType::toLLVMType(llvm::LLVMContext& ctx) {
         return llvm::PointerType::get(ctx, 0);
     }
@@ -291,6 +301,10 @@ namespace sakuraE::IR {
         return "string";
     }
 
+    fzlib::String IRStringBuilderType::toString() {
+        return "string_builder";
+    }
+
     fzlib::String IRPointerType::toString() {
         return elementType->toString() + "*";
     }
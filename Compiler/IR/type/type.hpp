@@ -24,6 +24,8 @@ namespace sakuraE::IR {
         BoolTyID,
         TypeInfoTyID,
         StringTyID,
+        // Growable buffer that the generator uses for append-only string variables in loops
+        StringBuilderTyID,
         // ComplexType
         RefTyID,
         PointerTyID,
@@ -56,10 +58,11 @@ namespace sakuraE::IR {
         IRType* getStorageType();
         IRTypeID getIRTypeID() const { return irTypeID; }
         bool isString() { return irTypeID == StringTyID; }
+        bool isStringBuilder() { return irTypeID == StringBuilderTyID; }
         bool isPointer() { return irTypeID == PointerTyID; }
         bool isRef() { return irTypeID == RefTyID; }
         bool isArray() { return irTypeID == ArrayTyID; }
-        bool isComplexType() { return isString() || isPointer() || isArray() || isRef(); }
+        bool isComplexType() { return isString() || isStringBuilder() || isPointer() || isArray() || isRef(); }
         bool isEqual(IRType* ty);
 
         virtual llvm::Type* toLLVMType(llvm::LLVMContext& ctx) = 0;
@@ -78,6 +81,7 @@ namespace sakuraE::IR {
         static IRType* getFloat64Ty();
         static IRType* getTypeInfoTy();
         static IRType* getStringTy();
+        static IRType* getStringBuilderTy();
         static IRType* getPointerTo(IRType* elementType);
         static IRType* getRefTo(IRType* elementType);
         static IRType* getArrayTy(IRType* elementType, uint64_t numElements);
@@ -166,6 +170,14 @@ namespace sakuraE::IR {
         fzlib::String toString() override;
     };
 
+    class IRStringBuilderType : public IRType {
+        friend class IRType;
+        IRStringBuilderType() : IRType(StringBuilderTyID) {}
+    public:
+        llvm::Type* toLLVMType(llvm::LLVMContext& ctx) override;
+        fzlib::String toString() override;
+    };
+
     class IRPointerType : public IRType {
         friend class IRType;
         IRType* elementType;
@@ -10,15 +10,19 @@
 #include "includes/String.hpp"
 #include <cstddef>
 #include <cstdint>
+#include <set>
+#include <string>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Constant.h>
 #include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Dominators.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/Alignment.h>
 #include <llvm/Support/Casting.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
 
 namespace sakuraE::Codegen {
     // LLVM Module
@@ -115,7 +119,6 @@ namespace sakuraE::Codegen {
         }
 
         codegenContext.builder->SetInsertPoint(entryBlock);
-        gcEnterScope();
 
         std::size_t i = 0;
         for (auto& arg: content->args()) {
@@ -127,7 +130,7 @@ namespace sakuraE::Codegen {
 
             codegenContext.builder->CreateStore(&arg, argAlloca);
 
-            // 参数如果承载的是 GC 托管对象引用，需要在函数入口立即注册进 root stack。
+            // 参数如果承载的是 GC 托管对象引用，它的槽位也是一个 root。
             if (shouldRegisterSlotAsGCRoot(irParams[i].second)) {
                 gcRegisterRoot(argAlloca);
             }
@@ -146,9 +149,382 @@ namespace sakuraE::Codegen {
                 codegenContext.instgen(inst, this);
             }
         }
+
+        expandInlineAllocations();
+        insertSafePointPolls();
+        insertStatepoints();
+        insertFrameRecord();
+    }
+
+    // 把大小是编译期常量的小对象分配展开成内联快路径：
+    //     cell = thread->alloc_buffers[cls].cursor
+    //     if (cell + cell_size <= limit) { cursor += cell_size; 写 header; payload = cell + header }
+    //     else payload = __gc_alloc(...)
+    // size class 在编译期确定，快路径只有两次 load、一次比较和几条 store，不经过运行时。
+    // 慢路径保留原来的调用，由运行时负责回收、清扫和重新装填缓冲区。
+    // arena 后端下换成 thread->arena 这一个区间，步长是 16 字节对齐后的大小；新块来自 mmap，不需要清零。
+    void LLVMCodeGenerator::LLVMFunction::expandInlineAllocations() {
+        if (inlineAllocSites.empty()) return;
+
+        auto* builder = codegenContext.builder;
+        auto* ptrTy = builder->getPtrTy();
+        auto* i8Ty = builder->getInt8Ty();
+        llvm::Value* thread = getGCThread();
+
+        for (auto* call: inlineAllocSites) {
+            uint64_t size = llvm::cast<llvm::ConstantInt>(call->getArgOperand(0))->getZExtValue();
+            uint64_t totalSize = sizeof(runtime::ObjectHeader) + size;
+            uint64_t cellSize = 0;
+            size_t cursorOffset = 0;
+            size_t limitOffset = 0;
+            if (usesCollector()) {
+                if (totalSize > runtime::HEAP_MAX_SMALL_SIZE) continue;
+
+                size_t classIndex = runtime::heap_size_class_index(totalSize);
+                size_t bufferOffset = offsetof(runtime::GCThreadContext, alloc_buffers) + classIndex * sizeof(runtime::GCAllocBuffer);
+                cellSize = runtime::HEAP_SIZE_CLASSES[classIndex];
+                cursorOffset = bufferOffset + offsetof(runtime::GCAllocBuffer, cursor);
+                limitOffset = bufferOffset + offsetof(runtime::GCAllocBuffer, limit);
+            }
+            else {
+                // 大对象在运行时里单独映射，不会从区间里切。
+                if (totalSize > runtime::ARENA_BLOCK_SIZE / 4) continue;
+
+                cellSize = runtime::arena_cell_size(totalSize);
+                cursorOffset = offsetof(runtime::GCThreadContext, arena) + offsetof(runtime::GCArenaBuffer, cursor);
+                limitOffset = offsetof(runtime::GCThreadContext, arena) + offsetof(runtime::GCArenaBuffer, limit);
+            }
+            bool zeroInit = usesCollector() && call->getCalledFunction()->getName() == "__gc_alloc";
+
+            builder->SetInsertPoint(call);
+            auto* cursorAddr = builder->CreateConstInBoundsGEP1_64(i8Ty, thread, cursorOffset, "gc.buffer.cursor");
+            auto* limitAddr = builder->CreateConstInBoundsGEP1_64(i8Ty, thread, limitOffset, "gc.buffer.limit");
+            auto* cell = builder->CreateLoad(ptrTy, cursorAddr, "gc.cell");
+            auto* limit = builder->CreateLoad(ptrTy, limitAddr, "gc.limit");
+            // 缓冲区为空时 cursor 与 limit 都是 null，比较必然失败；这里不能用 inbounds。
+            auto* next = builder->CreateConstGEP1_64(i8Ty, cell, cellSize, "gc.cell.next");
+            auto* fits = builder->CreateICmpULE(next, limit, "gc.cell.fits");
+
+            llvm::Instruction* fastTerm = nullptr;
+            llvm::Instruction* slowTerm = nullptr;
+            llvm::SplitBlockAndInsertIfThenElse(fits, call, &fastTerm, &slowTerm);
+            fastTerm->getParent()->setName("gc.alloc.fast");
+            slowTerm->getParent()->setName("gc.alloc.slow");
+            auto* contBlock = call->getParent();
+            contBlock->setName("gc.alloc.cont");
+
+            builder->SetInsertPoint(fastTerm);
+            builder->CreateStore(next, cursorAddr);
+            auto storeField = [&](size_t offset, llvm::Value* value) {
+                builder->CreateStore(value, builder->CreateConstInBoundsGEP1_64(i8Ty, cell, offset));
+            };
+            storeField(offsetof(runtime::ObjectHeader, type_info), call->getArgOperand(1));
+            // mark、flags 与保留字节相邻，用一次 i32 store 一起清零。
+            static_assert(runtime::Unmarked == 0);
+            static_assert(offsetof(runtime::ObjectHeader, obj_size) - offsetof(runtime::ObjectHeader, mark) == 4);
+            storeField(offsetof(runtime::ObjectHeader, mark), builder->getInt32(0));
+            storeField(offsetof(runtime::ObjectHeader, obj_size), builder->getInt32(size));
+            auto* payload = builder->CreateConstInBoundsGEP1_64(i8Ty, cell, sizeof(runtime::ObjectHeader), "gc.payload");
+            if (zeroInit && size > 0) {
+                builder->CreateMemSet(payload, builder->getInt8(0), size, llvm::MaybeAlign(16));
+            }
+
+            call->moveBefore(slowTerm);
+
+            builder->SetInsertPoint(contBlock, contBlock->begin());
+            auto* result = builder->CreatePHI(ptrTy, 2, "gc.alloc");
+            call->replaceAllUsesWith(result);
+            result->addIncoming(payload, fastTerm->getParent());
+            result->addIncoming(call, slowTerm->getParent());
+        }
+
+        inlineAllocSites.clear();
+    }
+
+    // 回边指跳向一个支配当前块的块（即循环头）的边。在回边和函数入口上轮询，
+    // 保证任何不分配内存的循环或递归也会定期经过 safe point，其他线程请求 stop-the-world 时不会被无限期拖住，
+    // 而直线代码没有额外开销。
+    void LLVMCodeGenerator::LLVMFunction::insertSafePointPolls() {
+        if (!usesCollector()) return;
+
+        llvm::DominatorTree domTree(*content);
+        std::vector<llvm::Instruction*> backEdges;
+
+        for (auto& block: *content) {
+            auto* term = block.getTerminator();
+            if (!term || !domTree.isReachableFromEntry(&block)) continue;
+
+            for (unsigned i = 0; i < term->getNumSuccessors(); i ++) {
+                if (domTree.dominates(term->getSuccessor(i), &block)) {
+                    backEdges.push_back(term);
+                    break;
+                }
+            }
+        }
+
+        // 入口的轮询放在 alloca 之后，拆出来的块不会带走入口块里的 alloca。
+        std::vector<llvm::Instruction*> pollPoints = {getEntryInsertionPoint()};
+        pollPoints.insert(pollPoints.end(), backEdges.begin(), backEdges.end());
+
+        auto* builder = codegenContext.builder;
+        llvm::Value* flag = parent->getSafePointFlag();
+
+        for (auto* term: pollPoints) {
+            builder->SetInsertPoint(term);
+
+            auto* requested = builder->CreateLoad(builder->getInt8Ty(), flag, "gc.safepoint.flag");
+            requested->setAtomic(llvm::AtomicOrdering::Monotonic);
+            auto* cond = builder->CreateICmpNE(requested, builder->getInt8(0), "gc.safepoint.requested");
+
+            auto* pollTerm = llvm::SplitBlockAndInsertIfThen(cond, term, false);
+            pollTerm->getParent()->setName("gc.safepoint");
+            term->getParent()->setName("gc.safepoint.cont");
+
+            builder->SetInsertPoint(pollTerm);
+            gcSafePoint();
+        }
+    }
+
+    // 不会触发回收的运行时函数，调用它们时不需要 statepoint。
+    static bool isGCLeafCallee(llvm::Function* callee) {
+        static const std::set<std::string> leafCallees = {
+            "__alloc",
+            "__free",
+            "free_string",
+            "__print",
+            "__println",
+            "__string_length",
+            "__string_equal",
+            "__string_compare",
+            "__string_find",
+            "__string_find_char",
+            "__string_hash",
+            "__gc_write_barrier",
+            "__gc_get_atomic_type",
+            "__gc_get_array_type",
+            "__gc_get_struct_type",
+            "__gc_current_thread"
+        };
+
+        return callee->isIntrinsic() || leafCallees.contains(callee->getName().str());
+    }
+
+    // 把所有可能触发回收的调用改写成 gc.statepoint，root 槽位作为 deopt 参数传入。
+    // 后端会为每个调用点在 .llvm_stackmaps 里记录这些槽位相对栈帧的位置，
+    // 运行时据此在原生栈上找到 root，生成代码里不再有任何 root 注册调用。
+    // 槽位被 statepoint 引用后不会被 mem2reg 提升，回收器读到的总是内存里的最新值。
+    void LLVMCodeGenerator::LLVMFunction::insertStatepoints() {
+        if (!usesStatepoints()) return;
+
+        // 运行时沿帧指针链回溯栈帧，并用每帧保存的 RBP 解析以 RBP 为基址的槽位，
+        // 所以即使函数本身没有 root，也要保留帧指针，链才不会在它这里断开。
+        content->addFnAttr("frame-pointer", "all");
+        if (gcRootSlots.empty()) return;
+
+        auto* builder = codegenContext.builder;
+
+        // 槽位可能在第一次赋值之前就经过某个调用点，所以统一挪到入口块开头并置空。
+        llvm::AllocaInst* lastSlot = nullptr;
+        for (auto* slot: gcRootSlots) {
+            if (lastSlot) slot->moveAfter(lastSlot);
+            else slot->moveBefore(&entryBlock->front());
+            lastSlot = slot;
+        }
+
+        builder->SetInsertPoint(lastSlot->getNextNode());
+        for (auto* slot: gcRootSlots) {
+            builder->CreateStore(llvm::Constant::getNullValue(slot->getAllocatedType()), slot);
+        }
+
+        std::vector<llvm::CallInst*> calls;
+        for (auto& block: *content) {
+            for (auto& inst: block) {
+                auto* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+                if (!call) continue;
+
+                auto* callee = call->getCalledFunction();
+                if (!callee || callee->isVarArg() || isGCLeafCallee(callee)) continue;
+
+                calls.push_back(call);
+            }
+        }
+
+        if (calls.empty()) return;
+
+        content->setGC("statepoint-example");
+        std::vector<llvm::Value*> liveSlots(gcRootSlots.begin(), gcRootSlots.end());
+
+        for (auto* call: calls) {
+            builder->SetInsertPoint(call);
+
+            std::vector<llvm::Value*> callArgs(call->arg_begin(), call->arg_end());
+            auto* statepoint = builder->CreateGCStatepointCall(
+                0, 0, call->getCalledFunction(),
+                llvm::ArrayRef<llvm::Value*>(callArgs),
+                llvm::ArrayRef<llvm::Value*>(liveSlots),
+                llvm::ArrayRef<llvm::Value*>(),
+                "gc.statepoint"
+            );
+
+            if (!call->getType()->isVoidTy()) {
+                auto* result = builder->CreateGCResult(statepoint, call->getType());
+                result->takeName(call);
+                call->replaceAllUsesWith(result);
+            }
+
+            call->eraseFromParent();
+        }
+    }
+
+    // 影子栈：函数的所有 root 槽位放进入口处分配的一个 frame record，
+    // { prev, root_count, roots[N] }，与运行时的 GCFrame 布局一致。
+    // 入口把它链到本线程 GCThreadContext 的 frame_top 上、每个 ret 之前恢复 prev，整个函数只有这两处写链表头，
+    // 槽位本身就是普通的栈内存，赋值时直接 store。
+    void LLVMCodeGenerator::LLVMFunction::insertFrameRecord() {
+        if (!usesShadowStack() || gcRootSlots.empty()) return;
+
+        auto* builder = codegenContext.builder;
+        auto* ptrTy = builder->getPtrTy();
+        auto* frameTy = llvm::StructType::get(*codegenContext.context, {
+            ptrTy,
+            builder->getInt64Ty(),
+            llvm::ArrayType::get(ptrTy, gcRootSlots.size())
+        });
+
+        builder->SetInsertPoint(entryBlock, entryBlock->getFirstInsertionPt());
+        auto* frame = builder->CreateAlloca(frameTy, nullptr, "gc.frame");
+
+        // 链表头要等拿到线程上下文之后才能访问，其余序言都放在入口的轮询之前。
+        auto* thread = llvm::cast<llvm::Instruction>(getGCThread());
+        builder->SetInsertPoint(thread->getNextNode());
+        auto* frameTop = builder->CreateConstInBoundsGEP1_64(builder->getInt8Ty(), thread, offsetof(runtime::GCThreadContext, frame_top), "gc.frame.top");
+
+        // 槽位可能在第一次赋值之前就被回收器看到，所以先全部置空。
+        for (std::size_t i = 0; i < gcRootSlots.size(); i ++) {
+            auto* slot = gcRootSlots[i];
+            auto* root = builder->CreateInBoundsGEP(frameTy, frame, {
+                builder->getInt32(0),
+                builder->getInt32(2),
+                builder->getInt32(i)
+            }, slot->getName());
+
+            builder->CreateStore(llvm::Constant::getNullValue(ptrTy), root);
+            slot->replaceAllUsesWith(root);
+        }
+
+        auto* prevFrame = builder->CreateLoad(ptrTy, frameTop, "gc.frame.prev");
+        builder->CreateStore(prevFrame, builder->CreateStructGEP(frameTy, frame, 0));
+        builder->CreateStore(builder->getInt64(gcRootSlots.size()), builder->CreateStructGEP(frameTy, frame, 1));
+        builder->CreateStore(frame, frameTop);
+
+        for (auto* slot: gcRootSlots) {
+            slot->eraseFromParent();
+        }
+
+        for (auto& block: *content) {
+            if (auto* ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(block.getTerminator())) {
+                builder->SetInsertPoint(ret);
+                builder->CreateStore(prevFrame, frameTop);
+            }
+        }
+
+        gcRootSlots.clear();
     }
 
     // Instruction generation
+    // 下标地址指向堆对象的内部，不能跨过可能触发压缩的分配保存。
+    // load / store 在使用处重新调用这里，从被 root 的基址（变量槽位或受保护的临时槽位）重新算出地址；
+    // 嵌套的下标同样逐层重新计算。下标值本身是普通整数，可以直接复用。
+    llvm::Value* LLVMCodeGenerator::indexingAddress(IR::Instruction* ins, LLVMFunction* curFn) {
+        llvm::Value* addr = isIndexing(ins->arg(0))
+                            ? indexingAddress(static_cast<IR::Instruction*>(ins->arg(0)), curFn)
+                            : toLLVMValue(ins->arg(0), curFn);
+        llvm::Value* indexVal = toLLVMValue(ins->arg(1), curFn);
+
+        auto addrIRType = ins->arg(0)->getType();
+        llvm::Type* elementType = nullptr;
+        auto* addrInst = dynamic_cast<IR::Instruction*>(ins->arg(0));
+        bool baseIsLValue = addrInst && addrInst->isLValue();
+
+        if (addrIRType->isArray()) {
+            if (baseIsLValue) {
+                addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), addr, "indexing.array.base");
+            }
+            elementType = static_cast<IR::IRArrayType*>(addrIRType)->getElementType()->toLLVMType(*context);
+        }
+        else if (addrIRType->isString()) {
+            if (baseIsLValue) {
+                addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), addr, "indexing.string.base");
+            }
+            elementType = IR::IRType::getCharTy()->toLLVMType(*context);
+        }
+        else if (addrIRType->isPointer()) {
+            auto* ptrTy = static_cast<IR::IRPointerType*>(addrIRType);
+            auto* pointeeTy = ptrTy->getElementType();
+
+            if (!pointeeTy) {
+                throw std::runtime_error("Indexing failed: pointer operand has no element type.");
+            }
+            if (!curFn->isRawCharPointerType(addrIRType)) {
+                throw std::runtime_error(
+                    "Indexing failed: only character pointers are currently supported for pointer indexing."
+                );
+            }
+
+            if (baseIsLValue) {
+                addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), addr, "indexing.ptr.base");
+            }
+            elementType = pointeeTy->toLLVMType(*context);
+        }
+        else if (addrIRType->isRef()) {
+            auto* refTy = static_cast<IR::IRRefType*>(addrIRType);
+            auto* refElementTy = refTy->getElementType();
+            llvm::Value* refAddr = addr;
+
+            if (baseIsLValue) {
+                refAddr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), refAddr, "indexing.ref.addr");
+            }
+
+            if (!refElementTy) {
+                throw std::runtime_error(
+                    "Indexing failed: reference operand has no element type."
+                );
+            }
+
+            if (refElementTy->isArray()) {
+                auto* arrayTy = static_cast<IR::IRArrayType*>(refElementTy);
+                addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), refAddr, "indexing.ref.array.base");
+                elementType = arrayTy->getElementType()->toLLVMType(*context);
+            }
+            else if (refElementTy->isString()) {
+                addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), refAddr, "indexing.ref.string.base");
+                elementType = IR::IRType::getCharTy()->toLLVMType(*context);
+            }
+            else if (curFn->isRawCharPointerType(refElementTy)) {
+                auto* ptrTy = static_cast<IR::IRPointerType*>(refElementTy);
+                addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), refAddr, "indexing.ref.ptr.base");
+                elementType = ptrTy->getElementType()->toLLVMType(*context);
+            }
+            else {
+                throw std::runtime_error(
+                    "Indexing failed: reference operand does not refer to an indexable value."
+                );
+            }
+        }
+        else {
+            throw std::runtime_error("Indexing failed: unsupported operand type.");
+        }
+
+        if (!addr) {
+            throw std::runtime_error("Indexing failed: null address operand.");
+        }
+        if (!elementType) {
+            throw std::runtime_error("Indexing failed: failed to resolve element type.");
+        }
+
+        return builder->CreateGEP(elementType, addr, {indexVal}, "indexing.ptr");
+    }
+
     llvm::Value* LLVMCodeGenerator::instgen(IR::Instruction* ins, LLVMFunction* curFn) {
         llvm::Value* instResult = nullptr;
         if (hasLLVMValue(ins)) return toLLVMValue(ins, curFn);
@@ -158,7 +534,8 @@ namespace sakuraE::Codegen {
                 auto constant = dynamic_cast<IR::Constant*>(ins->arg(0));
                 auto llvmConst = toLLVMConstant(constant, curFn);
                 bind(ins, llvmConst);
-                return toLLVMConstant(constant, curFn);
+
+                return llvmConst;
             }
             case IR::OpKind::add: {
                 llvm::Value* lhs = toLLVMValue(ins->arg(0), curFn);
@@ -248,11 +625,19 @@ namespace sakuraE::Codegen {
                 break;
             }
             case IR::OpKind::store: {
-                llvm::Value* destAddr = toLLVMValue(ins->arg(0), curFn);
                 llvm::Value* srcVal = toLLVMValue(ins->arg(1), curFn);
+                // 右边的求值可能分配并搬走被写的数组，下标地址在写入处重新计算。
+                llvm::Value* destAddr = isIndexing(ins->arg(0))
+                                        ? indexingAddress(static_cast<IR::Instruction*>(ins->arg(0)), curFn)
+                                        : toLLVMValue(ins->arg(0), curFn);
 
                 if (destAddr && srcVal) {
                     builder->CreateStore(srcVal, destAddr);
+
+                    if (curFn->needsWriteBarrier(ins->arg(0), ins->arg(1))) {
+                        curFn->gcWriteBarrier(destAddr, srcVal);
+                    }
+
                     bind(ins, srcVal);
                 }
                 else {
@@ -266,7 +651,7 @@ namespace sakuraE::Codegen {
                 auto irArray = irArrayConst->getContentValue<IR::IRArray*>();
 
                 std::vector<llvm::Value*> arrayContent;
-                bool openedTempScope = false;
+                std::vector<llvm::AllocaInst*> rootedSlots;
                 for (auto element: irArray->getArray()) {
                     llvm::Value* elementValue = toLLVMValue(element, curFn);
 
@@ -275,35 +660,40 @@ namespace sakuraE::Codegen {
                         elementValue = builder->CreateLoad(allocatedType, allocaInst, "array.elem.load");
                     }
 
+                    llvm::AllocaInst* rootedSlot = nullptr;
                     if (curFn->shouldTrackAsGCRoot(element)) {
-                        if (!openedTempScope) {
-                            curFn->gcEnterScope();
-                            openedTempScope = true;
-                        }
-
-                        auto* rootedSlot = curFn->createRootedTemporary(elementValue, "gc.array.elem");
-                        elementValue = builder->CreateLoad(rootedSlot->getAllocatedType(), rootedSlot, "array.elem.rooted");
+                        rootedSlot = curFn->createRootedTemporary(elementValue, "gc.array.elem");
                     }
 
                     arrayContent.push_back(elementValue);
+                    rootedSlots.push_back(rootedSlot);
                 }
                 auto arrayType = ins->getType()->toLLVMType(*context);
                 auto elementType = arrayType->getArrayElementType();  
 
-                // array object 的 payload 是实际数组内容，header 中只记录扫描规则与元素个数。
+                // array object 的 payload 是实际数组内容，header 中只记录扫描规则，元素个数由 payload 大小得出。
                 llvm::Value* gcType = curFn->parent->llvmTy2GCType(arrayType);
-                llvm::Value* elemCount = builder->getInt64(irArray->getSize());
-                llvm::Value* arrayPtr = curFn->createHeapAlloc(arrayType, gcType, elemCount);
+                // 元素都已经在分配之前求值完毕，下面的 store 会写满整个 payload，中间不会回收，因此不需要清零。
+                bool fullyInitialized = arrayType->getArrayNumElements() == arrayContent.size();
+                llvm::Value* arrayPtr = curFn->createHeapAlloc(arrayType, gcType, !fullyInitialized, curFn->getAllocSite(irArray->getInfo()));
+
+                // 压缩式回收可能在这次分配中搬走元素对象，所以被 root 的元素在分配之后才从槽位里读出。
+                for (std::size_t i = 0; i < arrayContent.size(); i ++) {
+                    if (auto* rootedSlot = rootedSlots[i]) {
+                        arrayContent[i] = builder->CreateLoad(rootedSlot->getAllocatedType(), rootedSlot, "array.elem.rooted");
+                    }
+                }
 
                 for (std::size_t i = 0; i < arrayContent.size(); i ++) {
                     auto ptr = builder->CreateGEP(elementType,
                                                             arrayPtr,
                                                             {builder->getInt32(i)});
                     builder->CreateStore(arrayContent[i], ptr);
-                }
 
-                if (openedTempScope) {
-                    curFn->gcLeaveScope();
+                    // 新数组在增量标记期间是黑色的，写入的元素必须经过 barrier 染灰。
+                    if (curFn->isManagedHeapType(irArray->getArray()[i]->getType())) {
+                        curFn->gcWriteBarrier(ptr, arrayContent[i]);
+                    }
                 }
 
                 if (curFn->shouldTrackAsGCRoot(ins)) {
@@ -315,93 +705,7 @@ namespace sakuraE::Codegen {
                 break;
             }
             case IR::OpKind::indexing: {
-                llvm::Value* addr = toLLVMValue(ins->arg(0), curFn);
-                llvm::Value* indexVal = toLLVMValue(ins->arg(1), curFn);
-
-                auto addrIRType = ins->arg(0)->getType();
-                llvm::Type* elementType = nullptr;
-                auto* addrInst = dynamic_cast<IR::Instruction*>(ins->arg(0));
-                bool baseIsLValue = addrInst && addrInst->isLValue();
-
-                if (addrIRType->isArray()) {
-                    if (baseIsLValue) {
-                        addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), addr, "indexing.array.base");
-                    }
-                    elementType = static_cast<IR::IRArrayType*>(addrIRType)->getElementType()->toLLVMType(*context);
-                }
-                else if (addrIRType->isString()) {
-                    if (baseIsLValue) {
-                        addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), addr, "indexing.string.base");
-                    }
-                    elementType = IR::IRType::getCharTy()->toLLVMType(*context);
-                }
-                else if (addrIRType->isPointer()) {
-                    auto* ptrTy = static_cast<IR::IRPointerType*>(addrIRType);
-                    auto* pointeeTy = ptrTy->getElementType();
-
-                    if (!pointeeTy) {
-                        throw std::runtime_error("Indexing failed: pointer operand has no element type.");
-                    }
-                    if (!curFn->isRawCharPointerType(addrIRType)) {
-                        throw std::runtime_error(
-                            "Indexing failed: only character pointers are currently supported for pointer indexing."
-                        );
-                    }
-
-                    if (baseIsLValue) {
-                        addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), addr, "indexing.ptr.base");
-                    }
-                    elementType = pointeeTy->toLLVMType(*context);
-                }
-                else if (addrIRType->isRef()) {
-                    auto* refTy = static_cast<IR::IRRefType*>(addrIRType);
-                    auto* refElementTy = refTy->getElementType();
-                    llvm::Value* refAddr = addr;
-
-                    if (baseIsLValue) {
-                        refAddr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), refAddr, "indexing.ref.addr");
-                    }
-
-                    if (!refElementTy) {
-                        throw std::runtime_error(
-                            "Indexing failed: reference operand has no element type."
-                        );
-                    }
-
-                    if (refElementTy->isArray()) {
-                        auto* arrayTy = static_cast<IR::IRArrayType*>(refElementTy);
-                        addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), refAddr, "indexing.ref.array.base");
-                        elementType = arrayTy->getElementType()->toLLVMType(*context);
-                    }
-                    else if (refElementTy->isString()) {
-                        addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), refAddr, "indexing.ref.string.base");
-                        elementType = IR::IRType::getCharTy()->toLLVMType(*context);
-                    }
-                    else if (curFn->isRawCharPointerType(refElementTy)) {
-                        auto* ptrTy = static_cast<IR::IRPointerType*>(refElementTy);
-                        addr = builder->CreateLoad(llvm::PointerType::getUnqual(*context), refAddr, "indexing.ref.ptr.base");
-                        elementType = ptrTy->getElementType()->toLLVMType(*context);
-                    }
-                    else {
-                        throw std::runtime_error(
-                            "Indexing failed: reference operand does not refer to an indexable value."
-                        );
-                    }
-                }
-                else {
-                    throw std::runtime_error("Indexing failed: unsupported operand type.");
-                }
-
-                if (!addr) {
-                    throw std::runtime_error("Indexing failed: null address operand.");
-                }
-                if (!elementType) {
-                    throw std::runtime_error("Indexing failed: failed to resolve element type.");
-                }
-
-                auto ptr = builder->CreateGEP(elementType, addr, {indexVal}, "indexing.ptr");
-
-                instResult = ptr;
+                instResult = indexingAddress(ins, curFn);
                 bind(ins, instResult);
                 break;
             }
@@ -419,18 +723,17 @@ namespace sakuraE::Codegen {
                 break;
             }
             case IR::OpKind::deref: {
+                // deref 是左值：结果是被指向（或被引用）的地址，读取由之后的 load 完成。
                 instResult = toLLVMValue(ins->arg(0), curFn);
 
-                if (ins->arg(0)->getType()->isRef()) {
-                    auto ty = ins->getType()->toLLVMType(*context);
-                    instResult = builder->CreateLoad(ty, instResult);
-                }
-
                 bind(ins, instResult);
                 break;
             }
             case IR::OpKind::load: {
-                llvm::Value* addr = toLLVMValue(ins->arg(0), curFn);
+                // 复合赋值在取下标之后、读取之前还会求值右边，同样重新计算下标地址。
+                llvm::Value* addr = isIndexing(ins->arg(0))
+                                    ? indexingAddress(static_cast<IR::Instruction*>(ins->arg(0)), curFn)
+                                    : toLLVMValue(ins->arg(0), curFn);
                 llvm::Type* type = ins->getType()->toLLVMType(*context);
 
                 instResult = builder->CreateLoad(type, addr, "load.tmp");
@@ -465,8 +768,6 @@ namespace sakuraE::Codegen {
                 break;
             }
             case IR::OpKind::ret: {
-                curFn->gcLeaveAllScopes();
-
                 if (ins->getOperands().empty()) {
                     instResult = builder->CreateRetVoid();
 
@@ -484,11 +785,11 @@ namespace sakuraE::Codegen {
                 auto insName = ins->getName();
                 auto fnName = insName.split('.')[1];
 
-                auto fn = curFn->parent->lookup(fnName)->content;
+                auto callee = curFn->parent->lookup(fnName);
+                auto fn = callee->content;
 
                 auto arguments = ins->getOperands();
                 std::vector<llvm::Value*> llvmArguments;
-                bool openedTempScope = false;
                 for (std::size_t i = 0; i < arguments.size(); i ++) {
                     auto argVal = toLLVMValue(arguments[i], curFn);
                     if (auto* allocaInst = llvm::dyn_cast<llvm::AllocaInst>(argVal)) {
@@ -499,11 +800,6 @@ namespace sakuraE::Codegen {
                     // 某个参数如果是 GC 对象引用，而后面还有新的参数求值或 callee 内部分配，
                     // 就必须先 spill 到一个已注册 root 的临时槽位里，避免它在调用期间被误回收。
                     if (curFn->shouldTrackAsGCRoot(arguments[i])) {
-                        if (!openedTempScope) {
-                            curFn->gcEnterScope();
-                            openedTempScope = true;
-                        }
-
                         auto* rootedSlot = curFn->createRootedTemporary(argVal, "gc.call.arg");
                         argVal = builder->CreateLoad(rootedSlot->getAllocatedType(), rootedSlot, "call.arg.rooted");
                     }
@@ -511,15 +807,19 @@ namespace sakuraE::Codegen {
                     llvmArguments.push_back(argVal);
                 }
 
+                // 运行时的字符串函数改调 __ 开头的版本。会分配的版本多一个分配点参数，堆 profiler 才能把分配归到调用处。
+                // 只看运行时模块里的声明，用户自己定义的 string_ 开头的函数照常调用。
+                if (callee->isRuntimeFunction() && (fn->getName() == "concat_string" || fn->getName().startswith("string_"))) {
+                    fn = curFn->parent->lookup(("__" + fn->getName()).str())->content;
+                    if (fn->arg_size() > llvmArguments.size())
+                        llvmArguments.push_back(curFn->getAllocSite(ins->getInfo()));
+                }
+
                 if (fn->getReturnType()->isVoidTy())
                     instResult = builder->CreateCall(fn, llvmArguments);
                 else
                     instResult = builder->CreateCall(fn, llvmArguments, ins->getName().c_str());
 
-                if (openedTempScope) {
-                    curFn->gcLeaveScope();
-                }
-
                 if (instResult && curFn->shouldTrackAsGCRoot(ins)) {
                     auto* protectedSlot = curFn->createRootedTemporary(instResult, "gc.call.result");
                     protectValue(ins, protectedSlot);
@@ -528,14 +828,43 @@ namespace sakuraE::Codegen {
                 bind(ins, instResult);
                 break;
             }
-            case IR::OpKind::enter_scope: {
-                curFn->gcEnterScope();
+            case IR::OpKind::concat_n: {
+                // 所有片段写进栈上的指针数组，运行时只分配一次。分配期间由运行时把数组各项注册为根，
+                // 所以片段不需要再逐个 spill 到 gc.call.arg 临时槽位。
+                auto parts = ins->getOperands();
+                auto* ptrType = llvm::PointerType::getUnqual(*context);
+                auto* partsType = llvm::ArrayType::get(ptrType, parts.size());
+                auto* partsSlot = curFn->createAlloca(partsType, nullptr, "concat.parts");
+
+                for (std::size_t i = 0; i < parts.size(); i ++) {
+                    auto partVal = toLLVMValue(parts[i], curFn);
+                    if (auto* allocaInst = llvm::dyn_cast<llvm::AllocaInst>(partVal)) {
+                        partVal = builder->CreateLoad(allocaInst->getAllocatedType(), allocaInst, "concat.part.load");
+                    }
+
+                    auto* partSlot = builder->CreateConstInBoundsGEP2_32(partsType, partsSlot, 0, i, "concat.part");
+                    builder->CreateStore(partVal, partSlot);
+                }
+
+                auto fn = curFn->parent->lookup("__concat_n")->content;
+                instResult = builder->CreateCall(fn, {
+                    builder->getInt32(parts.size()),
+                    partsSlot,
+                    curFn->getAllocSite(ins->getInfo())
+                }, "concat_n");
+
+                if (curFn->shouldTrackAsGCRoot(ins)) {
+                    auto* protectedSlot = curFn->createRootedTemporary(instResult, "gc.concat.result");
+                    protectValue(ins, protectedSlot);
+                }
+
+                bind(ins, instResult);
                 break;
             }
-            case IR::OpKind::leave_scope: {
-                curFn->gcLeaveScope();
+            // root 槽位属于整个函数的 frame record，词法作用域不再需要生成任何代码。
+            case IR::OpKind::enter_scope:
+            case IR::OpKind::leave_scope:
                 break;
-            }
             default:
                 break;
         }
@@ -1,6 +1,7 @@
 #ifndef SAKURAE_LLVMCODEGENERATOR_HPP
 #define SAKURAE_LLVMCODEGENERATOR_HPP
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <llvm/IR/Constant.h>
@@ -33,6 +34,7 @@
 #include "Compiler/IR/generator.hpp"
 #include "Compiler/IR/struct/function.hpp"
 #include "Compiler/IR/struct/instruction.hpp"
+#include "Runtime/thread.h"
 #include "Compiler/IR/struct/scope.hpp"
 #include "Compiler/IR/type/type.hpp"
 #include "Compiler/IR/value/value.hpp"
@@ -42,9 +44,23 @@
 namespace sakuraE::Codegen {
     class LLVMCodeGenerator {
     public:
+        // How generated code tells the collector where its GC roots live
+        enum class GCRootStrategy {
+            // Managed slots live in a per-function frame record linked into the runtime's frame chain
+            ShadowStack,
+            // Managed slots are listed in gc.statepoint stack maps and found by walking native frames
+            Statepoint,
+            // No rooting code at all; the runtime scans the native stack and registers conservatively
+            Conservative,
+            // Nothing is ever collected (arena backend): no roots, safe point polls or write barriers,
+            // and constant-size allocations bump the thread's arena buffer inline
+            None
+        };
+
         IR::Program* program;
         llvm::LLVMContext* context;
         llvm::IRBuilder<>* builder;
+        GCRootStrategy gcRootStrategy = GCRootStrategy::ShadowStack;
     private:
         // Struct Definition ==================================================
         enum class FunctionType {
@@ -75,8 +91,12 @@ namespace sakuraE::Codegen {
             LLVMCodeGenerator& codegenContext;
             // Params Alloca Map
             std::map<fzlib::String, llvm::AllocaInst*> paramAllocaMap;
-            // Active GC scope depth for the current function
-            uint32_t gcScopeDepth = 0;
+            // Managed root slots of the current function, laid out by insertFrameRecord or insertStatepoints
+            std::vector<llvm::AllocaInst*> gcRootSlots;
+            // Constant-size __gc_alloc calls, expanded by expandInlineAllocations
+            std::vector<llvm::CallInst*> inlineAllocSites;
+            // Cached __gc_current_thread() result at the top of the entry block, see getGCThread
+            llvm::CallInst* gcThread = nullptr;
             // SAK IR Function
             IR::Function* sourceFn;
 
@@ -99,61 +119,72 @@ namespace sakuraE::Codegen {
                         PositionInfo info):
                 type(ty), linkageName(lkn), name(n), content(nullptr), returnType(retT), formalParams(formalP), scope(IR::Scope<llvm::Value*>(info)), parent(p), codegenContext(codegen) {}
 
-            void gcEnterScope() {
-                auto fn = parent->lookup("__gc_enter_scope");
-                codegenContext.builder->CreateCall(fn->content, {});
-                gcScopeDepth ++;
+            // 是否是运行时模块里声明的函数，它们由 JIT 绑定到运行时库的实现上。
+            bool isRuntimeFunction() const {
+                return type == FunctionType::ExternalLinkage && sourceFn && sourceFn->getParent()->id() == "__runtime";
             }
 
-            void gcLeaveScope() {
-                if (gcScopeDepth == 0) return;
-                auto fn = parent->lookup("__gc_leave_scope");
-                codegenContext.builder->CreateCall(fn->content, {});
-                gcScopeDepth --;
+            bool usesShadowStack() const {
+                return codegenContext.gcRootStrategy == GCRootStrategy::ShadowStack;
             }
 
-            void gcLeaveAllScopes() {
-                while (gcScopeDepth > 0) {
-                    gcLeaveScope();
-                }
+            bool usesStatepoints() const {
+                return codegenContext.gcRootStrategy == GCRootStrategy::Statepoint;
             }
 
-            llvm::Value* gcAlloc(llvm::Value* size, llvm::Value* gcTy, llvm::Value* elemCount = nullptr) {
-                auto fn = parent->lookup("__gc_alloc");
+            bool usesCollector() const {
+                return codegenContext.gcRootStrategy != GCRootStrategy::None;
+            }
 
-                if (!elemCount) {
-                    elemCount = codegenContext.builder->getInt64(0);
+            // zeroInit 为 false 表示调用方会在下一次可能回收之前写满整个 payload，分配时不必清零。
+            // 大小是编译期常量的分配先生成运行时调用，之后由 expandInlineAllocations 展开成内联快路径。
+            // site 是 getAllocSite 发射的分配点描述符，供运行时的堆 profiler 归类。
+            llvm::Value* gcAlloc(llvm::Value* size, llvm::Value* gcTy, bool zeroInit = true, llvm::Value* site = nullptr) {
+                auto fn = parent->lookup(zeroInit ? "__gc_alloc" : "__gc_alloc_uninit");
+
+                if (!site) {
+                    site = llvm::ConstantPointerNull::get(codegenContext.builder->getPtrTy());
                 }
             
-                return codegenContext.builder->CreateCall(fn->content, {
+                auto* call = codegenContext.builder->CreateCall(fn->content, {
                     size,
                     gcTy,
-                    elemCount
+                    site
                 });
+
+                if (llvm::isa<llvm::ConstantInt>(size)) {
+                    inlineAllocSites.push_back(call);
+                }
+
+                return call;
             }
 
-            llvm::Value* gcAlloc(int size, llvm::Value* gcTy, uint64_t elemCount = 0) {
+            llvm::Value* gcAlloc(int size, llvm::Value* gcTy, llvm::Value* site = nullptr) {
                 auto fn = parent->lookup("__gc_alloc");
                 auto sTy = parent->content->getDataLayout().getIntPtrType(*codegenContext.context);
 
                 return codegenContext.builder->CreateCall(fn->content, {
                     llvm::ConstantInt::get(sTy, size),
                     gcTy,
-                    codegenContext.builder->getInt64(elemCount)
+                    site ? site : llvm::ConstantPointerNull::get(codegenContext.builder->getPtrTy())
                 });
             }
 
-            void gcRegisterRoot(llvm::Value* addr) {
-                auto fn = parent->lookup("__gc_register");
-                auto ptr = codegenContext.builder->CreateBitCast(addr, llvm::PointerType::getUnqual(*codegenContext.context));
-
-                codegenContext.builder->CreateCall(fn->content, {ptr});
+            // 当前函数中位于 info 处的分配点描述符。
+            llvm::GlobalVariable* getAllocSite(const PositionInfo& info) {
+                return parent->emitGCAllocSite(name, info);
             }
 
-            void gcPop(size_t times) {
-                if (times == 0) return;
-                auto fn = parent->lookup("__gc_pop");
-                codegenContext.builder->CreateCall(fn->content, {codegenContext.builder->getInt32(times)});
+            // 只记录槽位本身，函数生成完之后再统一决定它们的存放方式：
+            // 影子栈模式下变成 frame record 里的一个 root 槽位，statepoint 模式下写进每个调用点的 stack map。
+            void gcRegisterRoot(llvm::Value* addr) {
+                // 保守扫描模式下运行时自己在栈上找 root，不需要任何登记；arena 后端根本不回收。
+                if (codegenContext.gcRootStrategy == GCRootStrategy::Conservative || !usesCollector()) return;
+
+                auto* slot = llvm::cast<llvm::AllocaInst>(addr);
+                if (std::find(gcRootSlots.begin(), gcRootSlots.end(), slot) == gcRootSlots.end()) {
+                    gcRootSlots.push_back(slot);
+                }
             }
 
             void gcCollect() {
@@ -161,6 +192,37 @@ namespace sakuraE::Codegen {
                 codegenContext.builder->CreateCall(fn->content, {});
             }
 
+            void gcSafePoint() {
+                auto fn = parent->lookup("__gc_safe_point");
+                codegenContext.builder->CreateCall(fn->content, {});
+            }
+
+            // 入口块里 alloca 之后的第一条指令，函数序言代码插在它前面。
+            llvm::Instruction* getEntryInsertionPoint() {
+                for (auto& inst: *entryBlock) {
+                    if (!llvm::isa<llvm::AllocaInst>(inst) && &inst != gcThread) return &inst;
+                }
+                return nullptr;
+            }
+
+            // 本线程的 GCThreadContext，整个函数只在入口调用一次 __gc_current_thread。
+            // frame record 链表头与分配缓冲区都通过它按运行时结构体的偏移访问。
+            llvm::Value* getGCThread() {
+                if (gcThread) return gcThread;
+
+                auto fn = parent->lookup("__gc_current_thread");
+                llvm::IRBuilder<> entryBuilder(getEntryInsertionPoint());
+                gcThread = entryBuilder.CreateCall(fn->content, {}, "gc.thread");
+                return gcThread;
+            }
+
+            void gcWriteBarrier(llvm::Value* slot, llvm::Value* value) {
+                if (!usesCollector()) return;
+
+                auto fn = parent->lookup("__gc_write_barrier");
+                codegenContext.builder->CreateCall(fn->content, {slot, value});
+            }
+
             // 当前 GC 只把“真正的托管对象引用”纳入 root stack：
             // 1. string object
             // 2. array object，语义上对应 heap-allocated array payload
@@ -183,7 +245,8 @@ namespace sakuraE::Codegen {
                     return false;
                 }
 
-                if (ty->isArray()) {
+                // string builder 也是 GC 对象，只是不会流到用户代码里。
+                if (ty->isArray() || ty->isStringBuilder()) {
                     return true;
                 }
 
@@ -197,11 +260,14 @@ namespace sakuraE::Codegen {
 
                 if (auto* inst = dynamic_cast<IR::Instruction*>(value)) {
                     switch (inst->getKind()) {
-                        case IR::OpKind::constant:
                         case IR::OpKind::create_array:
                         case IR::OpKind::call:
+                        case IR::OpKind::concat_n:
                         case IR::OpKind::load:
                             return true;
+                        case IR::OpKind::constant:
+                            // 字符串字面量是不在 GC 堆上的常量对象，不需要 root。
+                            return false;
                         case IR::OpKind::gaddr:
                         case IR::OpKind::indexing:
                         case IR::OpKind::deref:
@@ -220,6 +286,17 @@ namespace sakuraE::Codegen {
                 return isManagedHeapType(ty);
             }
 
+            // 把托管对象引用写进另一个堆对象（目前只有数组元素）时需要 write barrier，
+            // 写进栈上的变量槽位则不需要。
+            bool needsWriteBarrier(IR::IRValue* dest, IR::IRValue* value) const {
+                if (!value || !isManagedHeapType(value->getType())) {
+                    return false;
+                }
+
+                auto* destInst = dynamic_cast<IR::Instruction*>(dest);
+                return destInst && destInst->getKind() == IR::OpKind::indexing;
+            }
+
             llvm::AllocaInst* createRootedTemporary(llvm::Value* value, const fzlib::String& slotName) {
                 auto* slot = createAlloca(value->getType(), nullptr, slotName);
                 codegenContext.builder->CreateStore(value, slot);
@@ -231,7 +308,7 @@ namespace sakuraE::Codegen {
                 llvm::BasicBlock* currentBlock = codegenContext.builder->GetInsertBlock();
                 llvm::BasicBlock::iterator currentPoint = codegenContext.builder->GetInsertPoint();
 
-                codegenContext.builder->SetInsertPoint(entryBlock, ++ entryBlock->getFirstInsertionPt());
+                codegenContext.builder->SetInsertPoint(entryBlock, entryBlock->getFirstInsertionPt());
                 llvm::AllocaInst* alloca = codegenContext.builder->CreateAlloca(ty, arraySize, n.c_str());
 
                 codegenContext.builder->SetInsertPoint(currentBlock, currentPoint);
@@ -239,12 +316,12 @@ namespace sakuraE::Codegen {
                 return alloca;
             }
 
-            llvm::Value* createHeapAlloc(llvm::Type* t, llvm::Value* gcTy, llvm::Value* elemCount) {
+            llvm::Value* createHeapAlloc(llvm::Type* t, llvm::Value* gcTy, bool zeroInit = true, llvm::Value* site = nullptr) {
                 size_t size = parent->content->getDataLayout().getTypeAllocSize(t);
                 llvm::Type* sizeTy = parent->content->getDataLayout().getIntPtrType(*codegenContext.context);
                 llvm::Value* sizeVal = llvm::ConstantInt::get(sizeTy, size);
 
-                return gcAlloc(sizeVal, gcTy, elemCount);
+                return gcAlloc(sizeVal, gcTy, zeroInit, site);
             }
 
             llvm::Value* getParamAddress(fzlib::String n) {
@@ -260,6 +337,14 @@ namespace sakuraE::Codegen {
             void impl(IR::Function* source);
             // Start LLVM IR Code generation
             void codegen();
+            // Expand constant-size heap allocations into an inline bump-pointer fast path
+            void expandInlineAllocations();
+            // Insert GC safe point polls in the prologue and on every loop back-edge of the generated function
+            void insertSafePointPolls();
+            // Rewrite calls that may collect into gc.statepoint calls carrying the root slots
+            void insertStatepoints();
+            // Move the root slots into a frame record linked into the current thread's frame chain
+            void insertFrameRecord();
         };
         // Represent LLVM Module Instance
         struct LLVMModule {
@@ -272,6 +357,14 @@ namespace sakuraE::Codegen {
             std::vector<LLVMModule*> useList;
             IR::Module* sourceModule;
 
+            // 已发射的 GC 类型描述符，key 与运行时的类型 key 一致
+            std::map<fzlib::String, llvm::GlobalVariable*> gcTypeDescriptors;
+            std::map<llvm::GlobalVariable*, fzlib::String> gcTypeDescriptorKeys;
+            // 已发射的分配点描述符，key 为 "函数名|行|列"
+            std::map<fzlib::String, llvm::GlobalVariable*> gcAllocSites;
+            // 已发射的字符串字面量对象，key 为字面量内容，值是指向 payload 的常量地址
+            std::map<fzlib::String, llvm::Constant*> stringLiterals;
+
 
             LLVMModule(fzlib::String id, llvm::LLVMContext& ctx, LLVMCodeGenerator& codegen):
                 ID(id), content(nullptr), codegenContext(codegen) {}
@@ -282,38 +375,167 @@ namespace sakuraE::Codegen {
                 }
             }
 
-            llvm::Value* getAtomicGCType() {
-                auto callee = content->getOrInsertFunction(
-                    "__gc_get_atomic_type",
-                    llvm::FunctionType::get(codegenContext.builder->getPtrTy(), false)
+            // 运行时导出的 safe point 请求标志，函数入口与循环回边上的轮询只读取它。
+            llvm::Value* getSafePointFlag() {
+                return content->getOrInsertGlobal("__gc_safepoint_requested", codegenContext.builder->getInt8Ty());
+            }
+
+            // 与运行时 GCTypeInfo { name, kind, contains_refs, struct_layout, array_layout } 的内存布局一致。
+            llvm::StructType* getGCTypeInfoTy() {
+                auto* ptrTy = codegenContext.builder->getPtrTy();
+                auto* i8Ty = codegenContext.builder->getInt8Ty();
+                return llvm::StructType::get(*codegenContext.context, {ptrTy, i8Ty, i8Ty, ptrTy, ptrTy});
+            }
+
+            // 与运行时 GCArrayLayout { member_size, is_ptr, member_type } 的内存布局一致。
+            llvm::StructType* getGCArrayLayoutTy() {
+                auto* ptrTy = codegenContext.builder->getPtrTy();
+                return llvm::StructType::get(*codegenContext.context, {
+                    codegenContext.builder->getInt32Ty(),
+                    codegenContext.builder->getInt8Ty(),
+                    ptrTy
+                });
+            }
+
+            // 以常量全局变量的形式发射一个 GCTypeInfo，key 与运行时 complex_gc_type_pool 的 key 相同，
+            // 同一模块内相同的类型只发射一次。
+            llvm::GlobalVariable* emitGCTypeDescriptor(const fzlib::String& key, uint8_t kind, bool containsRefs, llvm::Constant* arrayLayout) {
+                if (gcTypeDescriptors.contains(key)) {
+                    return gcTypeDescriptors[key];
+                }
+
+                auto* ptrTy = codegenContext.builder->getPtrTy();
+                auto* i8Ty = codegenContext.builder->getInt8Ty();
+                auto* nullPtr = llvm::ConstantPointerNull::get(llvm::cast<llvm::PointerType>(ptrTy));
+
+                auto* nameInit = llvm::ConstantDataArray::getString(*codegenContext.context, key.c_str());
+                auto* name = new llvm::GlobalVariable(
+                    *content, nameInit->getType(), true, llvm::GlobalValue::PrivateLinkage, nameInit, "__gc_type_name"
+                );
+
+                auto* info = new llvm::GlobalVariable(
+                    *content, getGCTypeInfoTy(), true, llvm::GlobalValue::PrivateLinkage,
+                    llvm::ConstantStruct::get(getGCTypeInfoTy(), {
+                        name,
+                        llvm::ConstantInt::get(i8Ty, kind),
+                        llvm::ConstantInt::get(i8Ty, containsRefs ? 1 : 0),
+                        nullPtr,
+                        arrayLayout ? arrayLayout : nullPtr
+                    }),
+                    "__gc_type"
+                );
+
+                gcTypeDescriptors[key] = info;
+                gcTypeDescriptorKeys[info] = key;
+                return info;
+            }
+
+            // 与运行时 GCAllocSite { function, line, column } 的内存布局一致。
+            llvm::StructType* getGCAllocSiteTy() {
+                auto* i32Ty = codegenContext.builder->getInt32Ty();
+                return llvm::StructType::get(*codegenContext.context, {codegenContext.builder->getPtrTy(), i32Ty, i32Ty});
+            }
+
+            // 以常量全局变量的形式发射一个分配点描述符，同一位置只发射一次。
+            llvm::GlobalVariable* emitGCAllocSite(const fzlib::String& function, const PositionInfo& info) {
+                fzlib::String key = function + "|" + std::to_string(info.line) + "|" + std::to_string(info.column);
+                if (gcAllocSites.contains(key)) {
+                    return gcAllocSites[key];
+                }
+
+                auto* nameInit = llvm::ConstantDataArray::getString(*codegenContext.context, function.c_str());
+                auto* name = new llvm::GlobalVariable(
+                    *content, nameInit->getType(), true, llvm::GlobalValue::PrivateLinkage, nameInit, "__gc_site_fn"
                 );
-                return codegenContext.builder->CreateCall(callee, {});
-            }
-
-            llvm::Value* getArrayGCType(bool isPtr, uint32_t length, llvm::Value* memTy) {
-                auto callee = content->getOrInsertFunction(
-                    "__gc_get_array_type",
-                    llvm::FunctionType::get(
-                        codegenContext.builder->getPtrTy(), 
-                        {
-                            llvm::Type::getInt1Ty(*codegenContext.context),
-                            llvm::Type::getInt32Ty(*codegenContext.context),
-                            codegenContext.builder->getPtrTy()
-                        }, 
-                        false
-                    )
+
+                auto* site = new llvm::GlobalVariable(
+                    *content, getGCAllocSiteTy(), true, llvm::GlobalValue::PrivateLinkage,
+                    llvm::ConstantStruct::get(getGCAllocSiteTy(), {
+                        name,
+                        codegenContext.builder->getInt32(info.line),
+                        codegenContext.builder->getInt32(info.column)
+                    }),
+                    "__gc_site"
                 );
-                return codegenContext.builder->CreateCall(
-                    callee, 
-                    {
-                        codegenContext.builder->getInt1(isPtr), 
-                        codegenContext.builder->getInt32(length), 
-                        memTy
-                    }
+
+                gcAllocSites[key] = site;
+                return site;
+            }
+
+            llvm::GlobalVariable* getAtomicGCType() {
+                // 对应运行时的 GCObjectKind::Atomic。
+                return emitGCTypeDescriptor("atomic", 0, false, nullptr);
+            }
+
+            // 字符串字面量发射成只读的常量字符串对象：header 与运行时 ObjectHeader 的布局一致，flags 带 Immortal，
+            // 后面紧跟字符和结尾的 NUL。对象不在 GC 堆上，回收器不会标记、释放或移动它，求值字面量不再分配。
+            // 同一模块内相同的字面量只发射一次，返回的 payload 地址是常量，可以在任意函数、任意基本块里使用。
+            llvm::Constant* getStringLiteral(const fzlib::String& str) {
+                if (stringLiterals.contains(str)) {
+                    return stringLiterals[str];
+                }
+
+                auto& ctx = *codegenContext.context;
+                auto* i8Ty = codegenContext.builder->getInt8Ty();
+                auto* i32Ty = codegenContext.builder->getInt32Ty();
+
+                static_assert(sizeof(runtime::ObjectHeader) == 16 && offsetof(runtime::ObjectHeader, obj_size) == 12);
+                auto* headerTy = llvm::StructType::get(ctx, {
+                    codegenContext.builder->getPtrTy(), i8Ty, i8Ty, codegenContext.builder->getInt16Ty(), i32Ty
+                });
+                auto* chars = llvm::ConstantDataArray::getString(ctx, llvm::StringRef(str.c_str(), str.len()), true);
+                auto* objectTy = llvm::StructType::get(ctx, {headerTy, chars->getType()});
+
+                auto* header = llvm::ConstantStruct::get(headerTy, {
+                    getAtomicGCType(),
+                    llvm::ConstantInt::get(i8Ty, runtime::Unmarked),
+                    llvm::ConstantInt::get(i8Ty, runtime::Immortal),
+                    llvm::ConstantInt::get(codegenContext.builder->getInt16Ty(), 0),
+                    llvm::ConstantInt::get(i32Ty, str.len() + 1)
+                });
+
+                auto* object = new llvm::GlobalVariable(
+                    *content, objectTy, true, llvm::GlobalValue::PrivateLinkage,
+                    llvm::ConstantStruct::get(objectTy, {header, chars}), "__string_literal"
+                );
+                // 与堆上的 cell 一样按 16 字节对齐
+                object->setAlignment(llvm::Align(16));
+
+                auto* payload = llvm::ConstantExpr::getInBoundsGetElementPtr(objectTy, object, llvm::ArrayRef<llvm::Constant*>{
+                    llvm::ConstantInt::get(i32Ty, 0),
+                    llvm::ConstantInt::get(i32Ty, 1)
+                });
+                stringLiterals[str] = payload;
+
+                return payload;
+            }
+
+            llvm::GlobalVariable* getArrayGCType(bool isPtr, uint32_t length, llvm::GlobalVariable* memTy) {
+                const fzlib::String& memKey = gcTypeDescriptorKeys[memTy];
+                fzlib::String key = "array|" + std::to_string(isPtr ? 1 : 0) + "|" + std::to_string(length) + "|" + memKey;
+                if (gcTypeDescriptors.contains(key)) {
+                    return gcTypeDescriptors[key];
+                }
+
+                bool memContainsRefs = llvm::cast<llvm::ConstantInt>(
+                    memTy->getInitializer()->getAggregateElement(2u)
+                )->isOne();
+
+                auto* layoutInit = llvm::ConstantStruct::get(getGCArrayLayoutTy(), {
+                    codegenContext.builder->getInt32(length),
+                    codegenContext.builder->getInt8(isPtr ? 1 : 0),
+                    memTy
+                });
+                auto* layout = new llvm::GlobalVariable(
+                    *content, getGCArrayLayoutTy(), true, llvm::GlobalValue::PrivateLinkage, layoutInit, "__gc_array_layout"
                 );
+
+                // 对应运行时的 GCObjectKind::Array。
+                return emitGCTypeDescriptor(key, 2, isPtr || memContainsRefs, layout);
             }
 
-            llvm::Value* llvmTy2GCType(llvm::Type* ty) {
+            // 分配点直接引用静态发射的类型描述符，运行时不再需要按 key 查表。
+            llvm::GlobalVariable* llvmTy2GCType(llvm::Type* ty) {
                 if (!ty) {
                     return getAtomicGCType();
                 }
@@ -325,7 +547,7 @@ namespace sakuraE::Codegen {
                     uint32_t elemSize = static_cast<uint32_t>(
                         content->getDataLayout().getTypeAllocSize(elemTy)
                     );
-                    llvm::Value* elemGcTy = elemIsPtr ? getAtomicGCType() : llvmTy2GCType(elemTy);
+                    llvm::GlobalVariable* elemGcTy = elemIsPtr ? getAtomicGCType() : llvmTy2GCType(elemTy);
                 
                     return getArrayGCType(elemIsPtr, elemSize, elemGcTy);
                 }
@@ -412,9 +634,6 @@ namespace sakuraE::Codegen {
         }
         // =====================================================================
 
-        // Resources ===========================================================
-        std::map<fzlib::String, llvm::Value*> stringPool;
-        // =====================================================================
     public:
         LLVMCodeGenerator()=default;
         LLVMCodeGenerator(IR::Program* p) {
@@ -432,6 +651,10 @@ namespace sakuraE::Codegen {
             for (auto mod: modules) delete mod;
         }
 
+        void setGCRootStrategy(GCRootStrategy strategy) {
+            gcRootStrategy = strategy;
+        }
+
         void start();
         std::vector<LLVMModule*> getModules() {
             return modules;
@@ -448,6 +671,12 @@ namespace sakuraE::Codegen {
         }
     private:
         llvm::Value* instgen(IR::Instruction* ins, LLVMFunction* curFn);
+        llvm::Value* indexingAddress(IR::Instruction* ins, LLVMFunction* curFn);
+
+        static bool isIndexing(IR::IRValue* value) {
+            auto* inst = dynamic_cast<IR::Instruction*>(value);
+            return inst && inst->getKind() == IR::OpKind::indexing;
+        }
 
         // Tool Methods =========================================================
         llvm::Value* toLLVMConstant(IR::Constant* constant, LLVMFunction* curFn) {
@@ -465,18 +694,7 @@ namespace sakuraE::Codegen {
                 case IR::IRTypeID::Float64TyID:
                     return llvm::ConstantFP::get(constant->getType()->toLLVMType(*context), constant->getContentValue<double>());
                 case IR::IRTypeID::StringTyID: {
-                    fzlib::String strVal = constant->getContentValue<fzlib::String>();
-
-                    if (stringPool.contains(strVal)) return stringPool[strVal];
-
-                    auto strVar = builder->CreateGlobalString(strVal.c_str(), "tmpstr");
-
-                    auto string_creator = curFn->parent->lookup("create_string");
-
-                    llvm::Value* heapStr = builder->CreateCall(string_creator->content, {strVar}, "heap_str");
-                    stringPool[strVal] = heapStr;
-
-                    return heapStr;
+                    return curFn->parent->getStringLiteral(constant->getContentValue<fzlib::String>());
                 }
                 case IR::IRTypeID::CharTyID: {
                     return llvm::ConstantInt::get(constant->getType()->toLLVMType(*context), constant->getContentValue<char>());
@@ -587,6 +805,41 @@ namespace sakuraE::Codegen {
                 builder->CreateFRem(lhs, rhs, "remftmp") : builder->CreateSRem(lhs, rhs, "remtmp");
         }
 
+        // 字符串对象 payload 的字节数（长度加结尾的 NUL），就是紧挨在 payload 前面的 ObjectHeader::obj_size。
+        llvm::Value* loadStringObjectSize(llvm::Value* str) {
+            constexpr int64_t offset = static_cast<int64_t>(offsetof(runtime::ObjectHeader, obj_size)) - static_cast<int64_t>(sizeof(runtime::ObjectHeader));
+            auto* addr = builder->CreateConstGEP1_64(builder->getInt8Ty(), str, offset, "str.size.addr");
+            return builder->CreateLoad(builder->getInt32Ty(), addr, "str.size");
+        }
+
+        // 同一个对象直接相等，长度不同直接不等，只有长度相同时才调用运行时的 __string_equal 比较内容。
+        llvm::Value* stringEqual(llvm::Value* lhs, llvm::Value* rhs, LLVMFunction* curFn) {
+            auto* fn = builder->GetInsertBlock()->getParent();
+            auto* entryBlock = builder->GetInsertBlock();
+            auto* sizeBlock = llvm::BasicBlock::Create(*context, "str.eq.size", fn);
+            auto* bodyBlock = llvm::BasicBlock::Create(*context, "str.eq.body", fn);
+            auto* doneBlock = llvm::BasicBlock::Create(*context, "str.eq.done", fn);
+
+            builder->CreateCondBr(builder->CreateICmpEQ(lhs, rhs, "str.same"), doneBlock, sizeBlock);
+
+            builder->SetInsertPoint(sizeBlock);
+            auto* lhsSize = loadStringObjectSize(lhs);
+            auto* rhsSize = loadStringObjectSize(rhs);
+            builder->CreateCondBr(builder->CreateICmpEQ(lhsSize, rhsSize, "str.size.eq"), bodyBlock, doneBlock);
+
+            builder->SetInsertPoint(bodyBlock);
+            auto* equalFn = curFn->parent->lookup("__string_equal")->content;
+            auto* bodyEqual = builder->CreateCall(equalFn, {lhs, rhs}, "str.body.eq");
+            builder->CreateBr(doneBlock);
+
+            builder->SetInsertPoint(doneBlock);
+            auto* equal = builder->CreatePHI(builder->getInt1Ty(), 3, "str.eq");
+            equal->addIncoming(builder->getTrue(), entryBlock);
+            equal->addIncoming(builder->getFalse(), sizeBlock);
+            equal->addIncoming(bodyEqual, bodyBlock);
+            return equal;
+        }
+
         llvm::Value* compare(
             llvm::Value* lhs,
             llvm::Value* rhs,
@@ -604,15 +857,11 @@ namespace sakuraE::Codegen {
                     throw std::runtime_error("Only '==' and '!=' are supported for string values.");
                 }
 
-                llvm::FunctionCallee strcmpFunc = curFn->parent->content->getOrInsertFunction(
-                    "strcmp", builder->getInt32Ty(), builder->getPtrTy(), builder->getPtrTy()
-                );
-                llvm::Value* res = builder->CreateCall(strcmpFunc, {lhs, rhs}, "strcmp.tmp");
-
+                llvm::Value* equal = stringEqual(lhs, rhs, curFn);
                 if (kind == IR::OpKind::lgc_equal) {
-                    return builder->CreateICmpEQ(res, builder->getInt32(0), "str.eq");
+                    return equal;
                 }
-                return builder->CreateICmpNE(res, builder->getInt32(0), "str.ne");
+                return builder->CreateNot(equal, "str.ne");
             }
 
             auto targetTy = promote(lhs, rhs);
@@ -0,0 +1,140 @@
+/*
+    SakuraE Runtime Library
+    arena.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "arena.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "profile.h"
+#include "stats.h"
+#include "thread.h"
+
+namespace sakuraE::runtime {
+    namespace {
+        struct ArenaBlock {
+            void* base;
+            size_t size;
+        };
+
+        // 以下状态由 GC 锁保护。arena 后端下不会有回收，GC 锁只用来串行化换块。
+        std::vector<ArenaBlock> arena_blocks;
+        // 开启堆 profiler 时所有线程共用的区间，每次分配都经过慢路径，才能逐个记录。
+        GCArenaBuffer profile_buffer = {};
+
+        size_t page_size() {
+            static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        // 新映射一块，记账后返回；超过 max_heap_bytes 或映射失败时返回 nullptr。
+        char* map_block(size_t bytes) {
+            if (gc_config.max_heap_bytes && allocated_bytes + bytes > gc_config.max_heap_bytes) {
+                return nullptr;
+            }
+
+            void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) {
+                return nullptr;
+            }
+
+            arena_blocks.push_back({ base, bytes });
+            allocated_bytes += bytes;
+            stats_record_allocated(bytes);
+            return static_cast<char*>(base);
+        }
+
+        // 慢路径：当前区间放不下时换一块新的。大对象单独映射，当前区间保持不变。
+        char* arena_refill(GCThread* self, size_t cell_size, size_t size, GCTypeInfo* ty, const GCAllocSite* site) {
+            GCLock lock(self);
+
+            GCArenaBuffer* buffer = &self->context.arena;
+            if (profile_enabled()) {
+                profile_record_alloc(site, ty, sizeof(ObjectHeader) + size);
+                buffer = &profile_buffer;
+                if (static_cast<size_t>(buffer->limit - buffer->cursor) >= cell_size) {
+                    char* cell = buffer->cursor;
+                    buffer->cursor += cell_size;
+                    return cell;
+                }
+            }
+
+            if (cell_size > ARENA_BLOCK_SIZE / 4) {
+                return map_block((cell_size + page_size() - 1) & ~(page_size() - 1));
+            }
+
+            char* block = map_block(ARENA_BLOCK_SIZE);
+            if (!block) {
+                return nullptr;
+            }
+
+            // 区间剩下的尾巴直接丢弃，arena 本来就不回收。
+            buffer->cursor = block + cell_size;
+            buffer->limit = block + ARENA_BLOCK_SIZE;
+            return block;
+        }
+    }
+
+    void* arena_alloc(GCThread* self, size_t size, GCTypeInfo* ty, const GCAllocSite* site) {
+        if (size > GC_MAX_OBJECT_SIZE) {
+            fprintf(stderr, "[Runtime Error] Object of %zu bytes exceeds the maximum object size of %zu bytes\n", size, GC_MAX_OBJECT_SIZE);
+            exit(1);
+        }
+
+        size_t cell_size = arena_cell_size(sizeof(ObjectHeader) + size);
+        GCArenaBuffer& buffer = self->context.arena;
+
+        char* cell = buffer.cursor;
+        if (static_cast<size_t>(buffer.limit - cell) >= cell_size) {
+            buffer.cursor += cell_size;
+        }
+        else {
+            cell = arena_refill(self, cell_size, size, ty, site);
+            if (!cell) {
+                // 退出时本线程的注销还要再拿一次 GC 锁，所以在锁外报告并退出。
+                fprintf(stderr, "[Runtime Error] Out of memory: the arena cannot allocate %zu more bytes (%zu bytes mapped)\n", cell_size, allocated_bytes);
+                exit(1);
+            }
+        }
+
+        auto* header = reinterpret_cast<ObjectHeader*>(cell);
+        header->type_info = ty ? ty : &GC_ATOMIC_TYPE;
+        header->obj_size = static_cast<uint32_t>(size);
+        return static_cast<void*>(header + 1);
+    }
+
+    void arena_release_all() {
+        for (const ArenaBlock& block : arena_blocks) {
+            munmap(block.base, block.size);
+        }
+        arena_blocks.clear();
+        profile_buffer = {};
+    }
+
+    extern "C" void* __arena_alloc(size_t size, GCTypeInfo* ty, const GCAllocSite* site) {
+        return arena_alloc(current_thread(), size, ty, site);
+    }
+
+    extern "C" void __arena_collect() {}
+
+    extern "C" void __arena_enter_scope() {}
+
+    extern "C" void __arena_leave_scope() {}
+
+    extern "C" void __arena_register(void**) {}
+
+    extern "C" void __arena_pop(uint32_t) {}
+
+    extern "C" void __arena_write_barrier(void*, void*) {}
+
+    extern "C" void __arena_safe_point() {}
+}
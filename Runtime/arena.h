@@ -0,0 +1,58 @@
+/*
+    SakuraE Runtime Library
+    arena.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_ARENA_H
+#define SAKURAE_RUNTIME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gc.h"
+
+namespace sakuraE::runtime {
+    // arena 后端：从不回收的 bump 分配器，给很快就退出的批处理程序用。
+    // 对象照常带 ObjectHeader，打印和字符串函数不需要区分后端；内存直到进程退出才整体归还。
+    // arena 里的对象不在 GC 堆上，回收器看不到它们，所以只应在程序开始运行前切换后端。
+
+    struct GCThread;
+
+    // 每个 mutator 线程一个 bump 区间，生成代码的内联快路径直接比较并推进 cursor。
+    // 区间为空时 cursor 与 limit 都是 null。
+    struct GCArenaBuffer {
+        char* cursor;
+        char* limit;
+    };
+
+    // 对象按 16 字节对齐，与 GC 堆上的 cell 一致。
+    constexpr size_t ARENA_ALIGNMENT = 16;
+    // 每次向系统申请的块大小；超过它四分之一的对象单独占一块，不打断当前区间。
+    constexpr size_t ARENA_BLOCK_SIZE = 1024 * 1024;
+
+    constexpr size_t arena_cell_size(size_t total_size) {
+        return (total_size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    }
+
+    // 分配一个 payload 为 size 字节的对象。块直接来自 mmap 且从不复用，payload 天然是零，不需要再清零。
+    void* arena_alloc(GCThread* self, size_t size, GCTypeInfo* ty, const GCAllocSite* site);
+
+    // 进程退出时归还所有块，GCCleaner 调用。
+    void arena_release_all();
+
+    // arena 后端下 JIT 把对应的 __gc_* 符号绑定到这些实现上。
+    // __gc_alloc 与 __gc_alloc_uninit 都绑定到 __arena_alloc；其余都是空操作。
+    extern "C" void* __arena_alloc(size_t size, GCTypeInfo* ty, const GCAllocSite* site = nullptr);
+    extern "C" void  __arena_collect();
+    extern "C" void  __arena_enter_scope();
+    extern "C" void  __arena_leave_scope();
+    extern "C" void  __arena_register(void** addr);
+    extern "C" void  __arena_pop(uint32_t times);
+    extern "C" void  __arena_write_barrier(void* slot, void* value);
+    extern "C" void  __arena_safe_point();
+}
+
+#endif // !SAKURAE_RUNTIME_ARENA_H
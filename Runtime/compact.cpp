@@ -0,0 +1,101 @@
+/*
+    SakuraE Runtime Library
+    compact.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "compact.h"
+
+#include <unordered_set>
+
+namespace sakuraE::runtime {
+    namespace {
+        inline void forward_slot(void** slot) {
+            if (*slot) {
+                *slot = heap_forward(*slot);
+            }
+        }
+
+        // 以下几个函数与 __gc_scan_struct / __gc_scan_embedded / __gc_scan_array 的遍历规则一一对应，
+        // 区别是这里需要指针所在的槽位，而不只是指针的值。
+        void forward_struct(char* base, GCStructLayout* layout) {
+            if (!layout) {
+                return;
+            }
+
+            for (uint32_t i = 0; i < layout->ptr_count; ++i) {
+                forward_slot(reinterpret_cast<void**>(base + layout->ptr_offsets[i]));
+            }
+        }
+
+        void forward_embedded(char* mem, GCTypeInfo* ty) {
+            if (!ty || !ty->contains_refs) {
+                return;
+            }
+
+            // 和 __gc_scan_embedded 一样，内嵌 array 还没有扫描路径。
+            if (ty->kind == GCObjectKind::Struct) {
+                forward_struct(mem, ty->struct_layout);
+            }
+        }
+
+        void forward_array(char* base, ObjectHeader* header, GCArrayLayout* layout) {
+            if (!layout || layout->member_size == 0) {
+                return;
+            }
+
+            uint64_t elem_count = header->obj_size / layout->member_size;
+            for (uint64_t i = 0; i < elem_count; ++i) {
+                char* element = base + i * layout->member_size;
+
+                if (layout->is_ptr) {
+                    forward_slot(reinterpret_cast<void**>(element));
+                    continue;
+                }
+
+                forward_embedded(element, layout->member_type);
+            }
+        }
+
+        void forward_object(ObjectHeader* header, void*) {
+            GCTypeInfo* type_info = header->type_info;
+            if (!type_info || !type_info->contains_refs) {
+                return;
+            }
+
+            auto* payload = reinterpret_cast<char*>(header + 1);
+            switch (type_info->kind) {
+                case GCObjectKind::Atomic:
+                    return;
+                case GCObjectKind::Struct:
+                    forward_struct(payload, type_info->struct_layout);
+                    return;
+                case GCObjectKind::Array:
+                    forward_array(payload, header, type_info->array_layout);
+                    return;
+            }
+        }
+    }
+
+    HeapEvacuationResult compact_heap(const std::vector<void**>& root_slots, const std::vector<void*>& pinned_refs) {
+        std::unordered_set<ObjectHeader*> pinned;
+        for (void* ref : pinned_refs) {
+            if (ObjectHeader* header = heap_find(ref)) {
+                pinned.insert(header);
+            }
+        }
+
+        HeapEvacuationResult result = heap_evacuate(pinned);
+        if (result.moved_objects > 0) {
+            for (void** slot : root_slots) {
+                forward_slot(slot);
+            }
+            heap_for_each_object(forward_object, nullptr);
+        }
+
+        heap_end_evacuation();
+        return result;
+    }
+}
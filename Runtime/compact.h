@@ -0,0 +1,25 @@
+/*
+    SakuraE Runtime Library
+    compact.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_COMPACT_H
+#define SAKURAE_RUNTIME_COMPACT_H
+
+#include <vector>
+
+#include "heap.h"
+
+namespace sakuraE::runtime {
+    // 压缩阶段：把稀疏 chunk 里的存活小对象搬走（evacuate-and-forward），腾空的 chunk 归还给系统。
+    // 调用前必须停下所有 mutator，并且堆已经完整清扫。
+    // root_slots 是精确 root 的槽位，搬迁后原地改写；pinned_refs 是只知道值、改不了来源的引用
+    // （stack map 与保守扫描在原生栈上找到的 root），它们指向的对象留在原处。
+    // 堆对象内部的指针字段按类型描述符逐个改写。
+    HeapEvacuationResult compact_heap(const std::vector<void**>& root_slots, const std::vector<void*>& pinned_refs);
+}
+
+#endif // !SAKURAE_RUNTIME_COMPACT_H
@@ -1,19 +1,29 @@
 #include "gc.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <list>
 #include <map>
-#include <stack>
 #include <vector>
 
+#include "arena.h"
+#include "compact.h"
+#include "heap.h"
+#include "mark.h"
+#include "native_stack.h"
+#include "profile.h"
+#include "stackmap.h"
+#include "stats.h"
+#include "thread.h"
 #include "includes/String.hpp"
 
 namespace sakuraE::runtime {
     size_t allocated_bytes = 0;
-    size_t limit = 1024 * 1024;
+    size_t limit = GCConfig {}.initial_heap_bytes;
 
     GCTypeInfo GC_ATOMIC_TYPE = {
         "atomic",
@@ -24,18 +34,11 @@ namespace sakuraE::runtime {
     };
 
     namespace {
-        constexpr size_t MIN_LIMIT = 1024 * 1024;
-
-        // 单线程实现只维护一套显式 root stack。
-        // root 中保存的是“槽位地址”，GC 每次扫描时再读取槽位里的最新指针值。
-        std::vector<void**> global_roots;
-
-        // 每次进入一个词法作用域时记录 root stack 的深度，
-        // 离开作用域后直接回退即可。
-        std::vector<size_t> scope_markers;
-
-        // 所有 GC 托管对象都挂在这条 heap list 上，sweep 阶段会线性遍历它。
-        std::vector<ObjectHeader*> global_heap;
+        constexpr unsigned long MAX_MARK_THREADS = 64;
+        // 堆逼近容器内存上限时，limit 至少比存活量多出这么多，避免每次分配都触发回收。
+        constexpr size_t MIN_HEAP_HEADROOM = 1024 * 1024;
+        // 自适应放大堆的倍数上限。
+        constexpr double MAX_HEAP_SCALE = 16.0;
 
         // 为 array / struct 这类复合类型缓存 GCTypeInfo，避免重复分配描述符。
         std::map<fzlib::String, GCTypeInfo*> complex_gc_type_pool;
@@ -44,37 +47,156 @@ namespace sakuraE::runtime {
         // 防止 collect 过程中再次递归进入 collect。
         bool gc_collecting = false;
 
-        inline char* payload_begin(ObjectHeader* header) {
-            return reinterpret_cast<char*>(header + 1);
+        // 分代模式下，自上次回收以来新分配的对象（young generation）。
+        // minor collection 只清扫这张表，不碰老对象。
+        std::vector<ObjectHeader*> young_objects;
+        size_t young_bytes = 0;
+
+        // 被 write barrier 记录下来的老对象：它们可能持有指向 young 对象的引用，
+        // minor collection 会把它们当作额外的 root 重新扫描一遍。
+        std::vector<ObjectHeader*> remembered_set;
+
+        // 增量标记周期是否正在进行。周期内新分配的对象直接标为 Marked（allocate black）。
+        bool incremental_marking = false;
+        // 周期内允许堆增长到的上限，超过后立即结束本轮标记，防止堆无限膨胀。
+        size_t incremental_hard_limit = 0;
+        std::chrono::steady_clock::time_point last_slice_end;
+
+        // 上一次回收留下的 chunk 是否还在惰性清扫中。
+        bool lazy_sweep_active = false;
+
+        // 自适应堆大小：按上一轮回收以来 GC 停顿占墙钟时间的比例，放大或缩小回收后的目标堆大小。
+        double heap_scale = 1.0;
+        std::chrono::steady_clock::time_point sizing_window_begin = std::chrono::steady_clock::now();
+        uint64_t sizing_pause_ns = 0;
+
+        // 容器（cgroup）的内存上限，没有限制时返回 0。
+        size_t container_memory_limit() {
+            for (const char* path : { "/sys/fs/cgroup/memory.max", "/sys/fs/cgroup/memory/memory.limit_in_bytes" }) {
+                FILE* file = std::fopen(path, "r");
+                if (!file) {
+                    continue;
+                }
+
+                unsigned long long value = 0;
+                bool parsed = std::fscanf(file, "%llu", &value) == 1;
+                std::fclose(file);
+
+                // cgroup v2 的 "max" 与 v1 里接近 2^63 的值都表示不限制。
+                return parsed && value < (1ull << 60) ? static_cast<size_t>(value) : 0;
+            }
+            return 0;
         }
 
-        inline char* payload_end(ObjectHeader* header) {
-            return payload_begin(header) + header->obj_size;
+        // 堆之外还有 JIT 代码、原生栈和运行时自己的元数据，所以只把容器上限的 3/4 留给 GC 堆。
+        size_t container_heap_cap() {
+            static const size_t cap = container_memory_limit() / 4 * 3;
+            return cap;
         }
 
-        inline bool contains_payload_address(ObjectHeader* header, void* ptr) {
-            if (!header || !ptr) {
-                return false;
+        // 存活量为 live 时下一次 full collection 的触发阈值。
+        // 容器上限只是软上限，不会导致分配失败；max_heap_bytes 是硬上限，由 ensure_heap_room 负责。
+        size_t heap_target(const GCConfig& config, size_t live) {
+            double grown = static_cast<double>(live) * config.growth_factor * heap_scale;
+            size_t target = grown >= static_cast<double>(SIZE_MAX / 2) ? SIZE_MAX / 2 : static_cast<size_t>(grown);
+            target = std::max(target, config.initial_heap_bytes);
+
+            if (size_t cap = container_heap_cap()) {
+                target = std::max(std::min(target, cap), live + MIN_HEAP_HEADROOM);
+            }
+            if (config.max_heap_bytes) {
+                target = std::min(target, config.max_heap_bytes);
             }
+            return target;
+        }
 
-            auto* addr = static_cast<char*>(ptr);
-            return addr >= payload_begin(header) && addr < payload_end(header);
+        void gc_set_mark_threads_to(GCConfig& config, unsigned long threads) {
+            config.mark_threads = static_cast<uint32_t>(std::clamp<unsigned long>(threads, 1, MAX_MARK_THREADS));
         }
 
-        // 这是一个简单但完整的单线程 GC，因此直接线性扫描 heap list 来定位对象。
-        // 这样除了 payload 起始地址，还能识别“指向对象内部”的 interior pointer。
-        ObjectHeader* find_header_by_address(void* ptr) {
-            if (!ptr) {
-                return nullptr;
+        GCConfig load_config_from_env() {
+            GCConfig config;
+
+            if (const char* value = std::getenv("SAKURAE_GC_GENERATIONAL")) {
+                config.generational = std::strcmp(value, "0") != 0;
             }
 
-            for (auto* header : global_heap) {
-                if (contains_payload_address(header, ptr)) {
-                    return header;
+            // SAKURAE_GC_BACKEND 比 SAKURAE_GC_GENERATIONAL 更具体，两者都设置时以它为准。
+            GCBackend backend;
+            if (gc_parse_backend(std::getenv("SAKURAE_GC_BACKEND"), backend)) {
+                config.arena = backend == GCBackend::Arena;
+                config.generational = backend == GCBackend::Generational;
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_NURSERY")) {
+                size_t bytes = std::strtoull(value, nullptr, 10);
+                if (bytes > 0) {
+                    config.nursery_bytes = bytes;
                 }
             }
 
-            return nullptr;
+            if (const char* value = std::getenv("SAKURAE_GC_THREADS")) {
+                gc_set_mark_threads_to(config, std::strtoul(value, nullptr, 10));
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_INCREMENTAL")) {
+                config.incremental = std::strcmp(value, "0") != 0;
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_PAUSE_US")) {
+                uint32_t budget = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+                if (budget > 0) {
+                    config.pause_budget_us = budget;
+                }
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_COMPACT")) {
+                config.compact = std::strcmp(value, "0") != 0;
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_COMPACT_THRESHOLD")) {
+                double threshold = std::strtod(value, nullptr);
+                if (threshold >= 0.0 && threshold <= 1.0) {
+                    config.compact_threshold = threshold;
+                }
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_INITIAL_HEAP")) {
+                if (size_t bytes = gc_parse_bytes(value)) {
+                    config.initial_heap_bytes = bytes;
+                }
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_MAX_HEAP")) {
+                config.max_heap_bytes = gc_parse_bytes(value);
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_GROWTH")) {
+                double factor = std::strtod(value, nullptr);
+                if (factor > 1.0) {
+                    config.growth_factor = factor;
+                }
+            }
+
+            if (const char* value = std::getenv("SAKURAE_GC_TIME_RATIO")) {
+                double ratio = std::strtod(value, nullptr);
+                if (ratio >= 0.0 && ratio < 1.0) {
+                    config.gc_time_ratio = ratio;
+                }
+            }
+
+            limit = heap_target(config, 0);
+            return config;
+        }
+
+        inline char* payload_begin(ObjectHeader* header) {
+            return reinterpret_cast<char*>(header + 1);
+        }
+
+        // 对象定位交给 GC 堆：小对象由 chunk 与 cell 大小直接算出，大对象走有序区间表。
+        // 除了 payload 起始地址，也能识别“指向对象内部”的 interior pointer。
+        inline ObjectHeader* find_header_by_address(void* ptr) {
+            return heap_find(ptr);
         }
 
         fzlib::String build_array_type_key(bool is_ptr, uint32_t size, GCTypeInfo* mem_ty) {
@@ -95,9 +217,565 @@ namespace sakuraE::runtime {
             return key;
         }
 
+        // 不持锁的 write barrier 会读 Remembered 位，与其他线程持锁设置它的写入并发，所以两边都用原子操作。
+        inline bool is_remembered(ObjectHeader* header) {
+            return std::atomic_ref<uint8_t>(header->flags).load(std::memory_order_relaxed) & Remembered;
+        }
+
         inline void refresh_limit_after_collect() {
-            limit = std::max(MIN_LIMIT, allocated_bytes == 0 ? MIN_LIMIT : allocated_bytes * 2);
+            limit = heap_target(gc_config, allocated_bytes);
+        }
+
+        // 所有 stop-the-world 停顿都经过这里，同时计入统计和自适应堆大小的时间窗口。
+        void record_gc_pause(uint64_t ns) {
+            stats_record_pause(ns);
+            sizing_pause_ns += ns;
+        }
+
+        // 每轮 full collection 调整一次：停顿占比超过目标时放大堆，低于目标一半时逐步缩回。
+        // 窗口里是上一轮回收以来的停顿，本轮停顿会计入下一次调整。
+        void adapt_heap_scale() {
+            auto now = std::chrono::steady_clock::now();
+            uint64_t window_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - sizing_window_begin).count();
+            double target = gc_config.gc_time_ratio;
+
+            if (target <= 0.0) {
+                heap_scale = 1.0;
+            }
+            else if (window_ns > 0) {
+                double ratio = static_cast<double>(sizing_pause_ns) / static_cast<double>(window_ns);
+                if (ratio > target) {
+                    heap_scale = std::min(heap_scale * 1.5, MAX_HEAP_SCALE);
+                }
+                else if (ratio < target / 2) {
+                    heap_scale = std::max(heap_scale / 1.25, 1.0);
+                }
+            }
+
+            sizing_window_begin = now;
+            sizing_pause_ns = 0;
+        }
+
+        // 把惰性清扫归还的字节从 allocated_bytes 中扣除。
+        // 死对象要等所在 chunk 被清扫后才计入，所以整轮清扫结束时才按真实存活量重新计算 limit。
+        void account_swept_bytes() {
+            size_t swept = heap_take_swept_bytes();
+            allocated_bytes -= std::min(allocated_bytes, swept);
+            stats_record_freed(swept);
+            stats_record_sweep(heap_take_sweep_ns());
+
+            // 这一轮清扫完成：记录存活量，并把腾空的 chunk 还给系统，内存峰值过后 RSS 可以回落。
+            if (lazy_sweep_active && !heap_sweep_pending()) {
+                lazy_sweep_active = false;
+                stats_record_live(allocated_bytes);
+                refresh_limit_after_collect();
+                heap_release_free_chunks();
+            }
+        }
+
+        // 标记结束后开始惰性清扫。清扫完成之前 allocated_bytes 仍包含死对象，
+        // 这里先按它放宽 limit，避免下一次分配立刻再触发回收。
+        void begin_lazy_sweep(bool keep_marks) {
+            GCStatsTimer timer;
+            HeapSweepResult swept = heap_begin_sweep(keep_marks);
+            allocated_bytes -= std::min(allocated_bytes, swept.freed_bytes);
+            stats_record_sweep(timer.elapsed_ns());
+            stats_record_freed(swept.freed_bytes);
+
+            stats_begin_sweep();
+            lazy_sweep_active = true;
+            adapt_heap_scale();
+            refresh_limit_after_collect();
+            account_swept_bytes();
+        }
+
+        // 分配缓冲区只在普通 stop-the-world 模式下启用：
+        // 分代模式要把每个新对象登记进 young_objects，增量模式要在分配时推进标记并 allocate black，
+        // 堆 profiler 要看到每一次分配。
+        inline bool alloc_buffer_enabled() {
+            return !gc_config.generational && !gc_config.incremental && !gc_collecting && !profile_enabled();
+        }
+
+        // 把快路径已经分配的字节计入 allocated_bytes。
+        void account_buffered_bytes() {
+            size_t buffered = heap_take_buffered_bytes();
+            allocated_bytes += buffered;
+            stats_record_allocated(buffered);
+        }
+
+        // 回收开始前收回所有线程的分配缓冲区，之后的堆遍历与记账都能看到快路径分配的对象。
+        // 调用方已经停下了其他 mutator。
+        void retire_alloc_buffers() {
+            for (GCThread* thread : gc_threads()) {
+                heap_flush_alloc_buffers(thread->context.alloc_buffers);
+            }
+            account_buffered_bytes();
+        }
+
+        // 新一轮标记开始前调用：未清扫 chunk 里的存活对象还带着上一轮的 mark。
+        void finish_lazy_sweep() {
+            heap_finish_sweep();
+            account_swept_bytes();
+        }
+
+        // 收集所有 mutator 线程的 root。
+        // 生成代码的 root 来自各线程的 frame record 链表，运行时和原生代码通过 __gc_register 登记 root 槽位，
+        // 这两类是精确的槽位，放进 slots；statepoint 模式由 stack map、保守模式由栈扫描在原生栈上找到的 root
+        // 只有值，放进 values。调用方已经停下了其他 mutator：它们的栈从停下时记录的位置开始扫描。
+        void collect_roots(std::vector<void**>& slots, std::vector<void*>& values) {
+            GCThread* self = current_thread();
+
+            for (GCThread* thread : gc_threads()) {
+                for (GCFrame* frame = thread->context.frame_top; frame; frame = frame->prev) {
+                    void** roots = frame->roots();
+                    for (uint64_t i = 0; i < frame->root_count; ++i) {
+                        if (roots[i]) {
+                            slots.push_back(&roots[i]);
+                        }
+                    }
+                }
+
+                for (void** addr : thread->roots) {
+                    if (addr && *addr) {
+                        slots.push_back(addr);
+                    }
+                }
+
+                if (thread == self) {
+                    stackmap_collect_roots(values);
+                    if (gc_config.conservative_stack) {
+                        conservative_collect_roots(values);
+                    }
+                    continue;
+                }
+
+                stackmap_scan_stack(values, thread->frame_pointer, thread->stack_top);
+                if (gc_config.conservative_stack) {
+                    conservative_scan_stack(values, thread->stack_bottom, thread->stack_top);
+                }
+            }
+        }
+
+        // root 里的当前指针，作为标记阶段的起点。
+        void collect_root_seeds(std::vector<void*>& seeds) {
+            std::vector<void**> slots;
+            collect_roots(slots, seeds);
+            for (void** slot : slots) {
+                seeds.push_back(*slot);
+            }
+
+            stats_record_roots(seeds.size());
+        }
+
+        void mark_from_roots() {
+            GCStatsTimer timer;
+            std::vector<void*> seeds;
+            collect_root_seeds(seeds);
+            mark_from_seeds(seeds, gc_config.mark_threads);
+            stats_record_mark(timer.elapsed_ns());
+        }
+
+        void reset_young_generation() {
+            young_objects.clear();
+            young_bytes = 0;
+
+            for (ObjectHeader* header : remembered_set) {
+                header->flags &= ~Remembered;
+            }
+            remembered_set.clear();
+        }
+
+        // 标记完成后判断是否需要压缩。分代模式下老对象的 mark 代表晋升状态，不能据此估算碎片。
+        bool compaction_due() {
+            return gc_config.compact && !gc_config.generational && heap_fragmentation() >= gc_config.compact_threshold;
+        }
+
+        // 搬迁稀疏 chunk 中的存活对象并改写所有指向它们的指针。调用方已经停下其他 mutator，且堆已完整清扫。
+        void compact_now() {
+            GCStatsTimer timer;
+            std::vector<void**> slots;
+            std::vector<void*> pinned;
+            collect_roots(slots, pinned);
+
+            HeapEvacuationResult moved = compact_heap(slots, pinned);
+            heap_release_free_chunks();
+            stats_record_compaction(moved.moved_bytes, timer.elapsed_ns());
+        }
+
+        // 完整回收整个堆。分代模式下存活对象在清扫后保持 Marked，即全部晋升为老对象。
+        // 碎片超过阈值时改为在停顿中清扫完整个堆，再做一次压缩。
+        void collect_full() {
+            finish_lazy_sweep();
+
+            if (gc_config.generational) {
+                heap_clear_marks();
+            }
+
+            mark_from_roots();
+            bool compact = compaction_due();
+            begin_lazy_sweep(gc_config.generational);
+            if (compact) {
+                finish_lazy_sweep();
+                compact_now();
+            }
+            reset_young_generation();
+        }
+
+        // minor collection：老对象保持 Marked，标记时遇到它们立即停下，
+        // 因此只会遍历从 root 与 remembered set 可达的 young 对象。
+        // 清扫只看 young_objects，停顿时间取决于存活的 young 对象，而不是整个堆。
+        void collect_minor() {
+            GCStatsTimer mark_timer;
+            std::vector<void*> seeds;
+            collect_root_seeds(seeds);
+
+            auto push_seed = [](void* obj, void* context) {
+                if (obj && context) {
+                    static_cast<std::vector<void*>*>(context)->push_back(obj);
+                }
+            };
+            for (ObjectHeader* header : remembered_set) {
+                __gc_scan_object(payload_begin(header), header, push_seed, &seeds);
+            }
+
+            mark_from_seeds(seeds, gc_config.mark_threads);
+            stats_record_mark(mark_timer.elapsed_ns());
+
+            GCStatsTimer sweep_timer;
+            size_t freed = 0;
+            for (ObjectHeader* header : young_objects) {
+                if (!heap_is_marked(header)) {
+                    freed += heap_free_object(header);
+                }
+            }
+            stats_record_sweep(sweep_timer.elapsed_ns());
+
+            allocated_bytes -= std::min(allocated_bytes, freed);
+            stats_record_freed(freed);
+            // 上一轮 full collection 还没清扫完时 allocated_bytes 里仍有死对象，不能当作存活量。
+            if (!lazy_sweep_active) {
+                stats_begin_sweep();
+                stats_record_live(allocated_bytes);
+            }
+            reset_young_generation();
+        }
+
+        inline bool incremental_enabled() {
+            return gc_config.incremental && !gc_config.generational;
+        }
+
+        inline uint64_t pause_budget_ns() {
+            return static_cast<uint64_t>(gc_config.pause_budget_us) * 1000;
+        }
+
+        // 两个 slice 之间至少让 mutator 运行一个 budget 的时间。
+        inline bool mark_slice_due() {
+            return std::chrono::steady_clock::now() - last_slice_end >= std::chrono::microseconds(gc_config.pause_budget_us);
+        }
+
+        // 推进一个增量标记 slice，grey stack 清空时返回 true。
+        bool run_mark_slice() {
+            GCStatsTimer timer;
+            bool drained = incremental_mark_step(pause_budget_ns());
+            last_slice_end = std::chrono::steady_clock::now();
+            stats_record_mark(timer.elapsed_ns());
+            stats_record_mark_slice();
+            return drained;
+        }
+
+        void start_incremental_cycle() {
+            finish_lazy_sweep();
+            stats_begin_cycle(GCCycleKind::Incremental);
+
+            GCStatsTimer timer;
+            std::vector<void*> seeds;
+            collect_root_seeds(seeds);
+
+            incremental_mark_start(seeds);
+            stats_record_mark(timer.elapsed_ns());
+            incremental_marking = true;
+            incremental_hard_limit = gc_config.max_heap_bytes ? std::min(limit * 2, gc_config.max_heap_bytes) : limit * 2;
+            safepoint_request_marking(true);
+
+            run_mark_slice();
+        }
+
+        // 结束增量周期：roots 在周期内没有 barrier 保护，所以这里重新扫描一遍，
+        // 再把剩余灰色对象标完后清扫。周期内死亡的对象要等到下一轮才会被回收。
+        void finish_incremental_cycle() {
+            GCStatsTimer timer;
+            std::vector<void*> roots;
+            collect_root_seeds(roots);
+            incremental_mark_finish(roots, gc_config.mark_threads);
+            stats_record_mark(timer.elapsed_ns());
+
+            incremental_marking = false;
+            safepoint_request_marking(false);
+
+            begin_lazy_sweep(false);
+        }
+
+        void abort_incremental_cycle() {
+            if (!incremental_marking) {
+                return;
+            }
+
+            incremental_mark_abort();
+            heap_clear_marks();
+            incremental_marking = false;
+            safepoint_request_marking(false);
+        }
+
+        // 分配路径上的增量 GC 调度：到达 limit 时开启新周期，周期内按时间片推进标记，
+        // 标记完成或堆增长到 hard limit 时结束周期并清扫。
+        // 每一步都会读写对象图，所以先停下其他 mutator。调用方持有 GC 锁。
+        void incremental_on_alloc(GCThread* self, size_t total_size) {
+            bool start = !incremental_marking && allocated_bytes + total_size > limit;
+            bool finish = incremental_marking && allocated_bytes + total_size > incremental_hard_limit;
+            bool slice = incremental_marking && !finish && mark_slice_due();
+            if (!start && !finish && !slice) {
+                return;
+            }
+
+            GCStatsTimer pause;
+            {
+                StopTheWorld stop(self);
+                if (start) {
+                    start_incremental_cycle();
+                }
+                else if (finish || run_mark_slice()) {
+                    finish_incremental_cycle();
+                }
+            }
+            record_gc_pause(pause.elapsed_ns());
+        }
+
+        // __gc_collect / __gc_collect_minor 的实现，调用方持有 GC 锁。
+        void run_full_collection(GCThread* self) {
+            if (gc_collecting) {
+                return;
+            }
+
+            gc_collecting = true;
+            stats_begin_cycle(GCCycleKind::Full);
+            GCStatsTimer pause;
+            {
+                StopTheWorld stop(self);
+                retire_alloc_buffers();
+                abort_incremental_cycle();
+                collect_full();
+            }
+            record_gc_pause(pause.elapsed_ns());
+            gc_collecting = false;
+        }
+
+        void run_minor_collection(GCThread* self) {
+            if (gc_collecting) {
+                return;
+            }
+
+            if (!gc_config.generational) {
+                run_full_collection(self);
+                return;
+            }
+
+            gc_collecting = true;
+            stats_begin_cycle(GCCycleKind::Minor);
+            GCStatsTimer pause;
+            {
+                StopTheWorld stop(self);
+                retire_alloc_buffers();
+                collect_minor();
+            }
+            record_gc_pause(pause.elapsed_ns());
+            gc_collecting = false;
+        }
+
+        // 分配会越过 max_heap_bytes 时先做一次 full collection 并清扫完，仍然放不下就报告内存不足。
+        // 返回 false 时调用方应当在放开 GC 锁之后退出。调用方持有 GC 锁。
+        bool ensure_heap_room(GCThread* self, size_t total_size) {
+            size_t max_heap = gc_config.max_heap_bytes;
+            if (max_heap == 0 || gc_collecting || allocated_bytes + total_size <= max_heap) {
+                return true;
+            }
+
+            run_full_collection(self);
+            finish_lazy_sweep();
+            if (allocated_bytes + total_size <= max_heap) {
+                return true;
+            }
+
+            fprintf(stderr,
+                    "[Runtime Error] Out of memory: allocating %zu bytes would exceed the maximum heap size of %zu bytes (%zu bytes live after a full collection)\n",
+                    total_size, max_heap, allocated_bytes);
+            return false;
+        }
+    }
+
+    GCConfig gc_config = load_config_from_env();
+
+    void gc_set_mark_threads(uint32_t threads) {
+        gc_set_mark_threads_to(gc_config, threads);
+    }
+
+    void gc_set_incremental(bool enabled) {
+        GCThread* self = current_thread();
+        GCLock lock(self);
+        if (gc_config.incremental == enabled) {
+            return;
+        }
+
+        run_full_collection(self);
+        gc_config.incremental = enabled;
+    }
+
+    void gc_set_pause_budget_us(uint32_t budget_us) {
+        if (budget_us > 0) {
+            gc_config.pause_budget_us = budget_us;
+        }
+    }
+
+    void gc_set_conservative_stack(bool enabled) {
+        gc_config.conservative_stack = enabled;
+    }
+
+    void gc_set_compact(bool enabled) {
+        GCLock lock(current_thread());
+        gc_config.compact = enabled;
+    }
+
+    void gc_set_compact_threshold(double threshold) {
+        if (!(threshold >= 0.0 && threshold <= 1.0)) {
+            return;
+        }
+
+        GCLock lock(current_thread());
+        gc_config.compact_threshold = threshold;
+    }
+
+    void gc_set_initial_heap(size_t bytes) {
+        if (bytes == 0) {
+            return;
+        }
+
+        GCLock lock(current_thread());
+        gc_config.initial_heap_bytes = bytes;
+        refresh_limit_after_collect();
+    }
+
+    void gc_set_max_heap(size_t bytes) {
+        GCLock lock(current_thread());
+        gc_config.max_heap_bytes = bytes;
+        refresh_limit_after_collect();
+    }
+
+    void gc_set_growth_factor(double factor) {
+        if (!(factor > 1.0)) {
+            return;
+        }
+
+        GCLock lock(current_thread());
+        gc_config.growth_factor = factor;
+        refresh_limit_after_collect();
+    }
+
+    void gc_set_gc_time_ratio(double ratio) {
+        if (!(ratio >= 0.0 && ratio < 1.0)) {
+            return;
+        }
+
+        GCLock lock(current_thread());
+        gc_config.gc_time_ratio = ratio;
+    }
+
+    size_t gc_parse_bytes(const char* text) {
+        if (!text) {
+            return 0;
+        }
+
+        char* end = nullptr;
+        unsigned long long value = std::strtoull(text, &end, 10);
+        if (end == text) {
+            return 0;
+        }
+
+        switch (*end) {
+            case 'g': case 'G':
+                value <<= 10;
+                [[fallthrough]];
+            case 'm': case 'M':
+                value <<= 10;
+                [[fallthrough]];
+            case 'k': case 'K':
+                value <<= 10;
+                ++end;
+                break;
+            default:
+                break;
+        }
+
+        // 允许写成 64MiB / 64MB。
+        if (*end == 'i' || *end == 'I') {
+            ++end;
+        }
+        if (*end == 'b' || *end == 'B') {
+            ++end;
+        }
+        return *end == '\0' ? static_cast<size_t>(value) : 0;
+    }
+
+    bool gc_parse_backend(const char* name, GCBackend& backend) {
+        if (!name) {
+            return false;
+        }
+
+        if (std::strcmp(name, "marksweep") == 0) {
+            backend = GCBackend::MarkSweep;
+        }
+        else if (std::strcmp(name, "gen") == 0) {
+            backend = GCBackend::Generational;
+        }
+        else if (std::strcmp(name, "arena") == 0) {
+            backend = GCBackend::Arena;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+
+    GCBackend gc_backend() {
+        if (gc_config.arena) {
+            return GCBackend::Arena;
+        }
+        return gc_config.generational ? GCBackend::Generational : GCBackend::MarkSweep;
+    }
+
+    void gc_set_backend(GCBackend backend) {
+        {
+            GCLock lock(current_thread());
+            gc_config.arena = backend == GCBackend::Arena;
+        }
+
+        // arena 下分代开关不起作用，保持原样，切回来时不用再做一次模式切换。
+        if (backend != GCBackend::Arena) {
+            gc_set_generational(backend == GCBackend::Generational);
+        }
+    }
+
+    void gc_set_generational(bool enabled) {
+        GCThread* self = current_thread();
+        GCLock lock(self);
+        if (gc_config.generational == enabled) {
+            return;
         }
+
+        // 先按旧模式把堆回收干净并清掉所有 mark，再切换模式后做一次 full collection。
+        // 这样分代模式一开始就满足“所有存活对象都是 Marked 的老对象”。
+        run_full_collection(self);
+        heap_clear_marks();
+        gc_config.generational = enabled;
+        run_full_collection(self);
     }
 
     extern "C" GCTypeInfo* __gc_get_atomic_type() {
@@ -109,6 +787,7 @@ namespace sakuraE::runtime {
             return nullptr;
         }
 
+        GCLock lock(current_thread());
         fzlib::String key = build_array_type_key(is_ptr, size, mem_ty);
         if (complex_gc_type_pool.contains(key)) {
             return complex_gc_type_pool[key];
@@ -140,6 +819,7 @@ namespace sakuraE::runtime {
             return nullptr;
         }
 
+        GCLock lock(current_thread());
         fzlib::String key = build_struct_type_key(name, ptr_count, ptr_offsets);
         if (complex_gc_type_pool.contains(key)) {
             return complex_gc_type_pool[key];
@@ -177,8 +857,8 @@ namespace sakuraE::runtime {
             return;
         }
 
-        auto* work_stack = static_cast<std::stack<void*>*>(context);
-        work_stack->push(obj);
+        auto* work_stack = static_cast<std::vector<void*>*>(context);
+        work_stack->push_back(obj);
     }
 
     extern "C" void __gc_scan_struct(void* obj, GCStructLayout* s_layout, void (*visit)(void*, void*), void* context) {
@@ -219,8 +899,13 @@ namespace sakuraE::runtime {
             return;
         }
 
+        if (a_layout->member_size == 0) {
+            return;
+        }
+
         auto* base = static_cast<char*>(obj);
-        for (uint64_t i = 0; i < header->elem_count; ++i) {
+        uint64_t elem_count = header->obj_size / a_layout->member_size;
+        for (uint64_t i = 0; i < elem_count; ++i) {
             void* element_addr = base + i * a_layout->member_size;
 
             if (a_layout->is_ptr) {
@@ -266,78 +951,177 @@ namespace sakuraE::runtime {
             return;
         }
 
-        std::stack<void*> work_stack;
-        work_stack.push(root);
+        std::vector<void*> work_stack { root };
 
         while (!work_stack.empty()) {
-            void* current = work_stack.top();
-            work_stack.pop();
+            void* current = work_stack.back();
+            work_stack.pop_back();
 
-            ObjectHeader* header = find_header_by_address(current);
-            if (!header || header->mark == Marked) {
+            ObjectHeader* header = heap_mark_claim(current, false);
+            if (!header) {
                 continue;
             }
 
-            header->mark = Marked;
             __gc_scan_object(payload_begin(header), header, __gc_wklist_push, &work_stack);
         }
     }
 
-    extern "C" void __gc_create_thread() {
-        // 当前版本是单线程 stop-the-world GC，接口仅保留 ABI 兼容。
-    }
+    // safe point 先响应其他线程的 stop-the-world 请求，再推进增量标记。
+    // 它只推进标记，不会结束周期或清扫：循环回边上可能还有未 root 的临时值，
+    // 真正释放内存只发生在分配路径上。
+    extern "C" void __gc_safe_point() {
+        GCThread* self = current_thread();
+        safepoint_park(self);
 
-    extern "C" void __gc_destroy_thread() {
-        // 当前版本是单线程 stop-the-world GC，接口仅保留 ABI 兼容。
-    }
+        GCLock lock(self);
+        if (!incremental_marking) {
+            safepoint_request_marking(false);
+            return;
+        }
 
-    extern "C" void __gc_safe_point() {
-        // 当前简单实现只在分配路径上触发 collect，不额外引入 safe point 逻辑。
+        if (gc_collecting || !mark_slice_due()) {
+            return;
+        }
+
+        gc_collecting = true;
+        GCStatsTimer pause;
+        {
+            StopTheWorld stop(self);
+            if (run_mark_slice()) {
+                // 暂时没有灰色对象了，在下一次分配结束周期之前不必再轮询。
+                safepoint_request_marking(false);
+            }
+        }
+        record_gc_pause(pause.elapsed_ns());
+        gc_collecting = false;
     }
 
     extern "C" void __gc_enter_scope() {
-        scope_markers.push_back(global_roots.size());
+        GCThread* self = current_thread();
+        self->scope_markers.push_back(self->roots.size());
     }
 
     extern "C" void __gc_leave_scope() {
-        if (scope_markers.empty()) {
+        GCThread* self = current_thread();
+        if (self->scope_markers.empty()) {
             return;
         }
 
-        size_t marker = scope_markers.back();
-        scope_markers.pop_back();
-        global_roots.resize(marker);
+        size_t marker = self->scope_markers.back();
+        self->scope_markers.pop_back();
+        self->roots.resize(marker);
     }
 
-    extern "C" void* __gc_alloc(size_t size, GCTypeInfo* ty, uint64_t member_count) {
-        const size_t total_size = sizeof(ObjectHeader) + size;
+    namespace {
+        inline void* init_object(ObjectHeader* header, size_t size, GCTypeInfo* ty, bool zero) {
+            header->type_info = ty ? ty : &GC_ATOMIC_TYPE;
+            header->mark = Unmarked;
+            header->flags = 0;
+            header->reserved = 0;
+            header->obj_size = static_cast<uint32_t>(size);
+
+            // 增量标记期间新对象直接标黑。空闲 cell 的 mark 位本来就是 0，其余情况不用碰 bitmap。
+            if (incremental_marking) {
+                heap_set_marked(header, true);
+            }
 
-        if (!gc_collecting && allocated_bytes + total_size > limit) {
-            __gc_collect();
+            void* payload = static_cast<void*>(header + 1);
+            if (zero) {
+                std::memset(payload, 0, size);
+            }
+            return payload;
         }
 
-        auto* header = static_cast<ObjectHeader*>(std::malloc(total_size));
-        if (!header) {
-            std::fprintf(stderr, "[Runtime Error] Out of memory in __gc_alloc\n");
-            std::exit(1);
+        // 慢路径：必要时回收，再从堆上分配并重新装填分配缓冲区。超过堆上限时返回 nullptr。
+        void* gc_alloc_slow(GCThread* self, size_t size, GCTypeInfo* ty, bool zero, const GCAllocSite* site) {
+            const size_t total_size = sizeof(ObjectHeader) + size;
+
+            GCLock lock(self);
+            heap_return_alloc_buffer(self->context.alloc_buffers, total_size);
+            account_buffered_bytes();
+
+            if (!gc_collecting) {
+                if (gc_config.generational && young_bytes + total_size > gc_config.nursery_bytes) {
+                    run_minor_collection(self);
+                }
+
+                if (incremental_enabled()) {
+                    gc_collecting = true;
+                    incremental_on_alloc(self, total_size);
+                    gc_collecting = false;
+                }
+                else if (allocated_bytes + total_size > limit) {
+                    run_full_collection(self);
+                }
+            }
+
+            if (!ensure_heap_room(self, total_size)) {
+                return nullptr;
+            }
+
+            size_t reserved_bytes = 0;
+            ObjectHeader* header = heap_alloc(total_size, reserved_bytes);
+            void* payload = init_object(header, size, ty, zero);
+
+            allocated_bytes += reserved_bytes;
+            stats_record_allocated(reserved_bytes);
+            if (profile_enabled()) {
+                profile_record_alloc(site, header->type_info, total_size);
+            }
+            if (lazy_sweep_active) {
+                account_swept_bytes();
+            }
+
+            if (gc_config.generational) {
+                young_objects.push_back(header);
+                young_bytes += reserved_bytes;
+            }
+
+            // 回收之后仍然超过 limit 说明存活量增长了，按堆大小策略重新计算。
+            if (allocated_bytes > limit && !incremental_marking) {
+                limit = heap_target(gc_config, allocated_bytes);
+            }
+
+            // 慢路径刚在当前 chunk 上 bump 过时，把 chunk 剩余部分借给本线程的快路径，
+            // 预算是距离下一次回收还能分配的字节数，由所有线程平分，缓冲区用完后再回到这里做 limit 检查。
+            if (alloc_buffer_enabled() && limit > allocated_bytes) {
+                heap_arm_alloc_buffer(self->context.alloc_buffers, total_size, (limit - allocated_bytes) / gc_threads().size());
+            }
+
+            return payload;
         }
 
-        header->type_info = ty ? ty : &GC_ATOMIC_TYPE;
-        header->mark = Unmarked;
-        header->obj_size = size;
-        header->elem_count = member_count;
+        void* gc_alloc(size_t size, GCTypeInfo* ty, bool zero, const GCAllocSite* site) {
+            if (size > GC_MAX_OBJECT_SIZE) {
+                fprintf(stderr, "[Runtime Error] Object of %zu bytes exceeds the maximum object size of %zu bytes\n", size, GC_MAX_OBJECT_SIZE);
+                exit(1);
+            }
 
-        void* payload = static_cast<void*>(header + 1);
-        std::memset(payload, 0, size);
+            GCThread* self = current_thread();
+            if (gc_config.arena) {
+                return arena_alloc(self, size, ty, site);
+            }
 
-        global_heap.push_back(header);
-        allocated_bytes += total_size;
+            // 快路径：缓冲区只属于本线程，不需要加锁；limit 检查已经在启用时按预算做过了。
+            if (ObjectHeader* header = heap_buffer_alloc(self->context.alloc_buffers, sizeof(ObjectHeader) + size)) {
+                return init_object(header, size, ty, zero);
+            }
 
-        if (allocated_bytes > limit) {
-            limit = std::max(limit * 2, allocated_bytes * 2);
+            void* payload = gc_alloc_slow(self, size, ty, zero, site);
+            if (!payload) {
+                // 报告已经在持锁时打印。退出时本线程的注销还要再拿一次 GC 锁，所以必须在锁外退出。
+                exit(1);
+            }
+            return payload;
         }
+    }
+
+    extern "C" void* __gc_alloc(size_t size, GCTypeInfo* ty, const GCAllocSite* site) {
+        return gc_alloc(size, ty, true, site);
+    }
 
-        return payload;
+    extern "C" void* __gc_alloc_uninit(size_t size, GCTypeInfo* ty, const GCAllocSite* site) {
+        return gc_alloc(size, ty, false, site);
     }
 
     extern "C" void __gc_register(void** addr) {
@@ -345,12 +1129,13 @@ namespace sakuraE::runtime {
             return;
         }
 
-        global_roots.push_back(addr);
+        current_thread()->roots.push_back(addr);
     }
 
     extern "C" void __gc_pop(uint32_t times) {
-        while (times > 0 && !global_roots.empty()) {
-            global_roots.pop_back();
+        std::vector<void**>& roots = current_thread()->roots;
+        while (times > 0 && !roots.empty()) {
+            roots.pop_back();
             --times;
         }
     }
@@ -359,49 +1144,100 @@ namespace sakuraE::runtime {
         __gc_scan_unlocked(ptr);
     }
 
-    // 单线程 stop-the-world mark-sweep：
-    // 1. 从显式 root stack 递归标记可达对象
-    // 2. 线性扫描 heap list，立即回收本轮未标记对象
+    // stop-the-world 标记 + 惰性清扫：
+    // 1. 停下其他 mutator 线程，从所有线程的 root 递归标记可达对象
+    // 2. 大对象当场回收；小对象 chunk 只登记为待清扫，由之后的分配按 size class 逐个清扫，
+    //    因此停顿时间只包含标记
     extern "C" void __gc_collect() {
-        if (gc_collecting) {
+        if (gc_config.arena) {
             return;
         }
 
-        gc_collecting = true;
+        GCThread* self = current_thread();
+        GCLock lock(self);
+        run_full_collection(self);
+    }
 
-        for (void** addr : global_roots) {
-            if (addr && *addr) {
-                __gc_scan_unlocked(*addr);
-            }
+    extern "C" void __gc_collect_minor() {
+        if (gc_config.arena) {
+            return;
         }
 
-        auto it = global_heap.begin();
-        while (it != global_heap.end()) {
-            ObjectHeader* header = *it;
+        GCThread* self = current_thread();
+        GCLock lock(self);
+        run_minor_collection(self);
+    }
+
+    // write barrier 有两个用途：
+    // 1. 增量标记期间把被写入的对象染灰（Dijkstra 插入式 barrier），防止黑对象指向白对象；
+    // 2. 分代模式下，老对象被写入 young 对象引用时，把老对象登记进 remembered set。
+    // 绝大多数写入什么也不用做，所以先不加锁地过滤，只有真正要染灰或登记时才拿 GC 锁：
+    // - incremental_marking 与 mark 位只在其他线程停下时改变，barrier 运行时它们是稳定的；
+    // - 对象定位用 heap_find_live，chunk 表可以不持锁查找，slot 和 value 都在存活对象里；
+    // - Remembered 位由持锁的 barrier 设置，这里只原子地读一下，拿到锁之后再确认。
+    // 等 GC 锁期间线程被视为已经停下，其他线程可能完成一次回收。这时 value 只被写进了还没有登记（或还没染灰）
+    // 的对象，回收看不到它，所以等锁期间把它临时放进本线程的 root stack，持锁后再重新检查条件。
+    // 压缩会改写 root stack 中的指针，因此持锁后按新的 value 重新查找。
+    extern "C" void __gc_write_barrier(void* slot, void* value) {
+        if (!value) {
+            return;
+        }
 
-            if (header->mark == Marked) {
-                header->mark = Unmarked;
-                ++it;
-                continue;
+        if (incremental_marking) {
+            ObjectHeader* target = heap_find_live(value);
+            if (!target || heap_is_marked(target)) {
+                return;
             }
 
-            allocated_bytes -= sizeof(ObjectHeader) + header->obj_size;
-            std::free(header);
-            it = global_heap.erase(it);
+            GCThread* self = current_thread();
+            self->roots.push_back(&value);
+            GCLock lock(self);
+            self->roots.pop_back();
+
+            target = heap_find(value);
+            if (incremental_marking && target && !heap_is_marked(target)) {
+                incremental_mark_shade(value);
+                safepoint_request_marking(true);
+            }
+            return;
         }
 
-        refresh_limit_after_collect();
-        gc_collecting = false;
+        if (!gc_config.generational || !slot) {
+            return;
+        }
+
+        ObjectHeader* holder = heap_find_live(slot);
+        if (!holder || !heap_is_marked(holder) || is_remembered(holder)) {
+            return;
+        }
+
+        ObjectHeader* target = heap_find_live(value);
+        if (!target || heap_is_marked(target)) {
+            return;
+        }
+
+        // 分代模式不做压缩，holder 与 target 不会移动。
+        GCThread* self = current_thread();
+        self->roots.push_back(&value);
+        GCLock lock(self);
+        self->roots.pop_back();
+
+        if (!heap_is_marked(holder) || is_remembered(holder) || heap_is_marked(target)) {
+            return;
+        }
+
+        std::atomic_ref<uint8_t>(holder->flags).fetch_or(Remembered, std::memory_order_relaxed);
+        remembered_set.push_back(holder);
     }
 
     struct GCCleaner {
         ~GCCleaner() {
-            for (auto* header : global_heap) {
-                std::free(header);
-            }
-            global_heap.clear();
-            global_roots.clear();
-            scope_markers.clear();
+            stats_report_at_exit();
+            profile_report_at_exit();
+            heap_release_all();
+            arena_release_all();
+            young_objects.clear();
+            remembered_set.clear();
 
             for (auto& [_, type_info] : complex_gc_type_pool) {
                 if (!type_info) {
@@ -13,11 +13,20 @@
 #include <cstdint>
 
 namespace sakuraE::runtime {
-    enum GCMark: uint32_t {
+    enum GCMark: uint8_t {
         Unmarked,
         Marked
     };
 
+    // 写在 ObjectHeader::flags 里的附加状态位。
+    enum GCObjectFlags: uint8_t {
+        // 老对象已经进入 remembered set，避免 write barrier 重复登记。
+        Remembered = 1u << 0,
+        // 不在 GC 堆上的只读常量对象，目前只有 codegen 发射的字符串字面量。
+        // heap_find 找不到它们，所以标记、清扫、压缩和 write barrier 都不会碰；要写入时必须先复制到堆上。
+        Immortal = 1u << 1
+    };
+
     enum class GCObjectKind: uint8_t {
         Atomic,
         Struct,
@@ -49,17 +58,120 @@ namespace sakuraE::runtime {
     };
 
     // ObjectHeader 紧挨在对象 payload 前面，生成代码只拿到 payload 指针。
+    // 16 字节，payload 保持 16 字节对齐。数组的元素个数不单独存放，由 obj_size / member_size 得出。
     struct ObjectHeader {
         GCTypeInfo* type_info;
+        // 只有大对象使用；小对象的 mark 位在所属 chunk 的 side bitmap 里，这里恒为 Unmarked。
         GCMark mark;
-        uint64_t obj_size;
-        uint64_t elem_count;
+        uint8_t flags;
+        uint16_t reserved;
+        // payload 的字节数，单个对象因此不能超过 4 GiB。
+        uint32_t obj_size;
+    };
+
+    static_assert(sizeof(ObjectHeader) == 16);
+
+    // 单个对象 payload 的上限，受 ObjectHeader::obj_size 的宽度限制。
+    constexpr size_t GC_MAX_OBJECT_SIZE = UINT32_MAX;
+
+    // 分配点描述符，codegen 为每个分配点发射一个常量，堆 profiler 按它归类采样到的分配。
+    // 内存布局是 codegen 与运行时之间的约定；手写的原生代码传 nullptr 即可。
+    struct GCAllocSite {
+        // 分配点所在函数的名字。
+        const char* function;
+        uint32_t line;
+        uint32_t column;
+    };
+
+    // 影子栈的一个 frame record，由生成代码分配在函数自己的栈帧上。
+    // 函数入口把它链到本线程 GCThreadContext 的 frame_top，返回前恢复 prev；root_count 个 root 槽位紧跟在结构体后面。
+    struct GCFrame {
+        GCFrame* prev;
+        uint64_t root_count;
+
+        void** roots() {
+            return reinterpret_cast<void**>(this + 1);
+        }
+    };
+
+    // 可选的 GC 后端。Generational 就是开启分代模式的 MarkSweep；Arena 从不回收，见 arena.h。
+    enum class GCBackend: uint8_t {
+        MarkSweep,
+        Generational,
+        Arena
+    };
+
+    // GC 运行参数。启动时从环境变量读取默认值，CLI 可以在运行前覆盖。
+    struct GCConfig {
+        // arena 后端：所有分配都走 bump 分配器，回收请求被忽略，其余参数都不生效。
+        bool arena = false;
+        // 分代模式：新对象先进入 young generation，由 minor collection 单独回收。
+        bool generational = false;
+        // young generation 累计分配超过该字节数时触发一次 minor collection。
+        size_t nursery_bytes = 4 * 1024 * 1024;
+        // 标记阶段使用的 GC 线程数，1 表示在发起回收的线程上串行标记。
+        uint32_t mark_threads = 1;
+        // 增量标记：把一次完整标记拆成若干个小 slice，在分配和 safe point 上穿插执行。
+        // 分代模式下不生效，那里的 minor collection 本身就足够短。
+        bool incremental = false;
+        // 单个增量标记 slice 的最长耗时（微秒）。
+        uint32_t pause_budget_us = 1000;
+        // 保守扫描原生栈和寄存器寻找 root，配合不注册 root 的生成代码使用。
+        bool conservative_stack = false;
+        // 压缩：full collection 标记后小对象堆的碎片率不低于 compact_threshold 时，
+        // 在停顿中清扫完整个堆，把稀疏 chunk 里的对象搬走。原生栈上只知道值的 root 指向的对象会被 pin 住。
+        // 分代模式下不生效。
+        bool compact = false;
+        double compact_threshold = 0.5;
+
+        // 第一次回收前允许分配的字节数，也是之后每轮回收 limit 的下限。
+        size_t initial_heap_bytes = 4 * 1024 * 1024;
+        // 堆大小上限，0 表示不限制。回收之后仍然放不下新对象时报告内存不足并退出。
+        size_t max_heap_bytes = 0;
+        // 回收后把 limit 设为存活量的多少倍。
+        double growth_factor = 2.0;
+        // 期望花在 GC 停顿上的时间占比，超过时放大堆、远低于它时再缩回来；0 表示关闭自适应。
+        double gc_time_ratio = 0.05;
     };
 
     extern size_t allocated_bytes;
     extern size_t limit;
     extern GCTypeInfo GC_ATOMIC_TYPE;
-
+    extern GCConfig gc_config;
+
+    // 选择 GC 后端。切到 MarkSweep / Generational 会关闭 arena 并按需切换分代模式。
+    void gc_set_backend(GCBackend backend);
+    GCBackend gc_backend();
+    // 解析 "marksweep" / "gen" / "arena"，名字不认识时返回 false。
+    bool gc_parse_backend(const char* name, GCBackend& backend);
+    // 切换分代模式。模式发生变化时会先做一次 full collection，保证新模式的堆不变式成立。
+    void gc_set_generational(bool enabled);
+    // 设置并行标记的线程数，会被限制在 [1, 64] 之内。
+    void gc_set_mark_threads(uint32_t threads);
+    // 开启 / 关闭增量标记。正在进行中的增量周期会被放弃并改做一次 full collection。
+    void gc_set_incremental(bool enabled);
+    void gc_set_pause_budget_us(uint32_t budget_us);
+    void gc_set_conservative_stack(bool enabled);
+    void gc_set_compact(bool enabled);
+    // 触发压缩的碎片率，取值 [0, 1]；0 表示每次 full collection 都尝试压缩。
+    void gc_set_compact_threshold(double threshold);
+    // 堆大小策略，设置后立即按当前堆占用重新计算 limit。
+    void gc_set_initial_heap(size_t bytes);
+    void gc_set_max_heap(size_t bytes);
+    // 增长系数必须大于 1，否则忽略。
+    void gc_set_growth_factor(double factor);
+    // 目标 GC 时间占比，取值 [0, 1)。
+    void gc_set_gc_time_ratio(double ratio);
+
+    // 解析 "64M" 这样的字节数，支持 K / M / G 后缀（以 1024 为底）。格式不对时返回 0。
+    size_t gc_parse_bytes(const char* text);
+
+    // 生成代码在函数入口和循环回边上读取这个标志，非 0 时才调用 __gc_safe_point。
+    // 其他线程请求 stop-the-world 或增量标记进行中时置位。
+    extern "C" uint8_t __gc_safepoint_requested;
+
+    // 编译期已知的类型由 codegen 直接发射为常量 GCTypeInfo，这几个接口只服务运行时动态构造的类型。
+    // 描述符的内存布局因此也是 codegen 与运行时之间的约定，修改字段时两边要一起改。
     extern "C" GCTypeInfo* __gc_get_atomic_type();
     extern "C" GCTypeInfo* __gc_get_array_type(bool is_ptr, uint32_t size, GCTypeInfo* mem_ty);
     extern "C" GCTypeInfo* __gc_get_struct_type(const char* name, uint32_t ptr_count, const uint32_t* ptr_offsets);
@@ -72,19 +184,35 @@ namespace sakuraE::runtime {
     extern "C" void __gc_scan_object(void* obj, ObjectHeader* header, void (*visit)(void*, void*), void* ctx);
     extern "C" void __gc_scan_unlocked(void* root);
 
-    // 这些接口仅为了兼容现有 JIT / codegen 的调用约定而保留。
-    // 在当前单线程实现里，它们本身不再承担实际工作。
+    // 登记 / 注销当前线程为 mutator。线程第一次调用运行时时会自动登记、退出时自动注销，
+    // 显式调用只是让登记发生在确定的位置。
     extern "C" void   __gc_create_thread();
     extern "C" void   __gc_destroy_thread();
+
+    // 包住一段可能长时间阻塞、且期间不碰托管对象的原生代码（例如 join 其他线程）。
+    // 在这段区间内本线程被视为已经停下，回收器不会等它；它的 root 必须都在登记过的槽位里。
+    extern "C" void   __gc_enter_blocking();
+    extern "C" void   __gc_leave_blocking();
+
+    // 其他线程请求 stop-the-world 时在这里停下；增量标记期间推进一个标记 slice。
     extern "C" void   __gc_safe_point();
 
+    // 显式 root 栈，供手写的原生代码登记 root；生成代码使用 GCFrame，不再调用它们。
     extern "C" void   __gc_enter_scope();
     extern "C" void   __gc_leave_scope();
-    extern "C" void*  __gc_alloc(size_t size, GCTypeInfo* ty, uint64_t member_count = 0);
     extern "C" void   __gc_register(void** addr);
     extern "C" void   __gc_pop(uint32_t times);
+
+    // site 是分配点描述符，只在开启堆 profiler 时被读取。
+    // 数组对象的元素个数由 size 与类型里的 member_size 决定。
+    extern "C" void*  __gc_alloc(size_t size, GCTypeInfo* ty, const GCAllocSite* site = nullptr);
+    // 与 __gc_alloc 相同但不清零 payload，供 codegen 在下一次可能回收之前就写满整个 payload 的分配使用。
+    extern "C" void*  __gc_alloc_uninit(size_t size, GCTypeInfo* ty, const GCAllocSite* site = nullptr);
     extern "C" void   __gc_scan(void* ptr);
     extern "C" void   __gc_collect();
+    extern "C" void   __gc_collect_minor();
+    // 生成代码把 GC 对象引用写进堆对象（例如数组元素）之后调用，slot 是被写入的地址。
+    extern "C" void   __gc_write_barrier(void* slot, void* value);
 }
 
 #endif // SakuraE 运行时 GC 头文件保护
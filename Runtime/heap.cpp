@@ -0,0 +1,1119 @@
+/*
+    SakuraE Runtime Library
+    heap.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "heap.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace sakuraE::runtime {
+    namespace {
+        constexpr size_t CLASS_LOOKUP_GRANULE = 16;
+
+        constexpr size_t MAX_LAZY_SWEEP_CHUNKS = 16;
+
+        // chunk 的地址空间每次向系统预留这么多个，再逐个切给 size class。
+        constexpr size_t CHUNK_RESERVE_COUNT = 16;
+
+        // chunk 表按用户态地址的低 48 位划分：根表与叶子各 16 位，每个叶子覆盖 4 GiB 地址空间。
+        constexpr size_t ADDRESS_BITS = 48;
+        constexpr size_t TABLE_LEAF_BITS = 16;
+        constexpr size_t TABLE_ROOT_BITS = ADDRESS_BITS - HEAP_CHUNK_SHIFT - TABLE_LEAF_BITS;
+
+        // chunk 表项的最低位为 1 时存放的是大对象的 ObjectHeader*，否则是 HeapChunk*。
+        constexpr uintptr_t LARGE_ENTRY_TAG = 1;
+
+        // 最小的 size class 也能放下一个 chunk 的全部 cell 的 mark 位。
+        constexpr size_t MARK_WORDS = HEAP_CHUNK_SIZE / HEAP_SIZE_CLASSES.front() / 64;
+
+        // total_size -> size class 下标的查表，按 16 字节粒度展开。
+        constexpr auto CLASS_LOOKUP = [] {
+            std::array<uint8_t, HEAP_MAX_SMALL_SIZE / CLASS_LOOKUP_GRANULE + 1> table {};
+            size_t cls = 0;
+            for (size_t i = 0; i < table.size(); ++i) {
+                while (HEAP_SIZE_CLASSES[cls] < i * CLASS_LOOKUP_GRANULE) {
+                    ++cls;
+                }
+                table[i] = static_cast<uint8_t>(cls);
+            }
+            return table;
+        }();
+
+        inline size_t class_index_of(size_t total_size) {
+            return CLASS_LOOKUP[(total_size + CLASS_LOOKUP_GRANULE - 1) / CLASS_LOOKUP_GRANULE];
+        }
+
+        struct HeapChunk {
+            char* base;
+            uint32_t class_index;
+            uint32_t cell_size;
+            uint32_t cell_count;
+            // [0, bump_index) 范围内的 cell 已经被切分出去，之后的部分从未使用过。
+            uint32_t bump_index = 0;
+            // 惰性清扫只处理 [0, sweep_limit)：它之后的 cell 是回收结束后才分配的，一定存活。
+            uint32_t sweep_limit = 0;
+            // 在所属 size class 的 chunks 中的下标，用于 O(1) 摘除。
+            uint32_t slot = 0;
+            // 租用该 chunk 的分配缓冲区。租用期间已切分的范围以缓冲区的 cursor 为准，bump_index 停在租用起点。
+            GCAllocBuffer* lease = nullptr;
+            // 每个 cell 一位的 mark bitmap，标记阶段只写这里。
+            std::array<uint64_t, MARK_WORDS> mark_bits {};
+            // 压缩期间作为搬迁源时，记录每个 cell 中对象的新地址，未搬走的为 nullptr。
+            std::unique_ptr<ObjectHeader*[]> forwarding;
+        };
+
+        // 空闲 cell 的前 16 字节复用为 free list 节点。
+        // free_tag 与 ObjectHeader::type_info 重叠且恒为 nullptr，借此区分空闲 cell 与存活对象。
+        struct FreeCell {
+            GCTypeInfo* free_tag;
+            FreeCell* next;
+        };
+
+        static_assert(sizeof(FreeCell) <= HEAP_SIZE_CLASSES.front());
+
+        struct ChunkTableLeaf {
+            std::array<std::atomic<uintptr_t>, size_t(1) << TABLE_LEAF_BITS> entries {};
+        };
+
+        // 地址按 HEAP_CHUNK_SIZE 划分后的编号 -> 占用它的 chunk 或大对象。
+        // 修改只在持有 GC 锁时发生，查找可以不持锁（write barrier 的快路径）：
+        // 叶子分配后不再释放，表项都是原子变量，并发的查找只会读到修改前或修改后的值，
+        // 不会像散列表那样在扩容重排时读到不完整的状态。
+        class ChunkTable {
+        public:
+            uintptr_t load(uintptr_t addr) const {
+                if (addr >> ADDRESS_BITS) {
+                    return 0;
+                }
+
+                uintptr_t index = addr >> HEAP_CHUNK_SHIFT;
+                ChunkTableLeaf* leaf = leaves[index >> TABLE_LEAF_BITS].load(std::memory_order_acquire);
+                if (!leaf) {
+                    return 0;
+                }
+                return leaf->entries[index & LEAF_MASK].load(std::memory_order_acquire);
+            }
+
+            // 登记或清除 [begin, begin + bytes) 覆盖的所有表项，begin 按 HEAP_CHUNK_SIZE 对齐。
+            void store(uintptr_t begin, size_t bytes, uintptr_t entry) {
+                if ((begin + bytes - 1) >> ADDRESS_BITS) {
+                    std::fprintf(stderr, "[Runtime Error] GC heap address out of the supported range\n");
+                    std::exit(1);
+                }
+
+                for (uintptr_t addr = begin; addr < begin + bytes; addr += HEAP_CHUNK_SIZE) {
+                    uintptr_t index = addr >> HEAP_CHUNK_SHIFT;
+                    std::atomic<ChunkTableLeaf*>& slot = leaves[index >> TABLE_LEAF_BITS];
+
+                    ChunkTableLeaf* leaf = slot.load(std::memory_order_relaxed);
+                    if (!leaf) {
+                        if (!entry) {
+                            continue;
+                        }
+                        leaf = new ChunkTableLeaf {};
+                        slot.store(leaf, std::memory_order_release);
+                    }
+                    leaf->entries[index & LEAF_MASK].store(entry, std::memory_order_release);
+                }
+            }
+
+        private:
+            static constexpr uintptr_t LEAF_MASK = (uintptr_t(1) << TABLE_LEAF_BITS) - 1;
+
+            std::array<std::atomic<ChunkTableLeaf*>, size_t(1) << TABLE_ROOT_BITS> leaves {};
+        };
+
+        struct SizeClass {
+            FreeCell* free_list = nullptr;
+            // 当前正在 bump 分配的 chunk。
+            HeapChunk* current = nullptr;
+            std::vector<HeapChunk*> chunks;
+            // 上一次回收后还没有清扫的 chunk。
+            std::vector<HeapChunk*> unswept;
+        };
+
+        struct HeapState {
+            std::array<SizeClass, HEAP_SIZE_CLASSES.size()> size_classes;
+
+            // chunk 与大对象的映射都按 HEAP_CHUNK_SIZE 对齐，因此地址右移即可查到它所属的 chunk 或大对象，
+            // interior pointer 也一样。
+            ChunkTable chunk_table;
+
+            // 大对象直接向系统申请，按地址有序登记，供清扫与遍历使用。
+            std::map<uintptr_t, ObjectHeader*> large_objects;
+            // 大对象映射占用的字节数（按页取整），也包含在 allocated_bytes 里。
+            size_t large_bytes = 0;
+
+            // 向系统预留的 chunk 地址空间，进程退出时整体 munmap。
+            std::vector<std::pair<char*, size_t>> chunk_regions;
+            // 空闲的 chunk 内存：dirty 的物理页还在，clean 的从未使用过或者已经 madvise 还给系统。
+            // 新 chunk 优先复用 dirty 的，避免重新触发缺页。
+            std::vector<char*> dirty_chunks;
+            std::vector<char*> clean_chunks;
+            // 累计还给系统的字节数：madvise 掉的空闲 chunk 与 munmap 掉的大对象。
+            size_t released_bytes = 0;
+
+            // 当前这轮惰性清扫是否保留存活对象的 mark（分代模式）。
+            bool sweep_keep_marks = false;
+            size_t unswept_chunks = 0;
+            // 惰性清扫归还、但还没有被 gc.cpp 记账的字节数。
+            size_t swept_bytes = 0;
+            // 惰性清扫累计耗时、但还没有被 gc.cpp 计入统计的纳秒数。
+            uint64_t sweep_ns = 0;
+            // 分配慢路径顺带清扫其他 size class 时的轮询位置。
+            size_t sweep_cursor = 0;
+            // 收回分配缓冲区时统计到、但还没有被 gc.cpp 记账的字节数。
+            size_t buffered_bytes = 0;
+            // 本次压缩选中的搬迁源 chunk，heap_end_evacuation 之后清空。
+            std::vector<HeapChunk*> evacuated;
+        };
+
+        // gc.cpp 的 GCCleaner 会在静态析构阶段调用 heap_release_all，
+        // 跨编译单元的析构顺序不确定，所以堆状态本身刻意不析构。
+        HeapState& state() {
+            static auto* heap_state = new HeapState {};
+            return *heap_state;
+        }
+
+        inline char* cell_at(HeapChunk* chunk, size_t index) {
+            return chunk->base + index * chunk->cell_size;
+        }
+
+        inline size_t cell_index(HeapChunk* chunk, uintptr_t addr) {
+            return (addr - reinterpret_cast<uintptr_t>(chunk->base)) / chunk->cell_size;
+        }
+
+        inline bool test_mark(HeapChunk* chunk, size_t index) {
+            return (chunk->mark_bits[index / 64] >> (index % 64)) & 1;
+        }
+
+        inline void clear_mark(HeapChunk* chunk, size_t index) {
+            chunk->mark_bits[index / 64] &= ~(uint64_t(1) << (index % 64));
+        }
+
+        inline HeapChunk* chunk_of(uintptr_t addr) {
+            uintptr_t entry = state().chunk_table.load(addr);
+            return (entry & LARGE_ENTRY_TAG) ? nullptr : reinterpret_cast<HeapChunk*>(entry);
+        }
+
+        // chunk 中已经切分出去的 cell 数。
+        inline size_t used_cells(HeapChunk* chunk) {
+            if (chunk->lease) {
+                return static_cast<size_t>(chunk->lease->cursor - chunk->base) / chunk->cell_size;
+            }
+            return chunk->bump_index;
+        }
+
+        [[noreturn]] void out_of_memory() {
+            std::fprintf(stderr, "[Runtime Error] Out of memory in __gc_alloc\n");
+            std::exit(1);
+        }
+
+        size_t page_size() {
+            static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        // 大对象映射的大小：header 加 payload，按页取整。
+        inline size_t large_mapping_size(size_t total_size) {
+            return (total_size + page_size() - 1) & ~(page_size() - 1);
+        }
+
+        // 映射 bytes 字节、按 HEAP_CHUNK_SIZE 对齐的匿名内存：多映射一个 chunk 的长度，再裁掉首尾不对齐的部分。
+        char* map_chunk_aligned(size_t bytes) {
+            void* raw = mmap(nullptr, bytes + HEAP_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) {
+                out_of_memory();
+            }
+
+            auto begin = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (begin + HEAP_CHUNK_SIZE - 1) & ~(HEAP_CHUNK_SIZE - 1);
+            size_t head = aligned - begin;
+            if (head > 0) {
+                munmap(raw, head);
+            }
+            if (HEAP_CHUNK_SIZE - head > 0) {
+                munmap(reinterpret_cast<void*>(aligned + bytes), HEAP_CHUNK_SIZE - head);
+            }
+
+            return reinterpret_cast<char*>(aligned);
+        }
+
+        // 预留 CHUNK_RESERVE_COUNT 个按 HEAP_CHUNK_SIZE 对齐的 chunk。
+        void reserve_chunks() {
+            HeapState& heap = state();
+            size_t bytes = HEAP_CHUNK_SIZE * CHUNK_RESERVE_COUNT;
+
+            char* base = map_chunk_aligned(bytes);
+            heap.chunk_regions.push_back({ base, bytes });
+            // 倒序压栈，让低地址的 chunk 先被取走。
+            for (size_t i = CHUNK_RESERVE_COUNT; i-- > 0;) {
+                heap.clean_chunks.push_back(base + i * HEAP_CHUNK_SIZE);
+            }
+        }
+
+        char* take_chunk_memory() {
+            HeapState& heap = state();
+            std::vector<char*>& pool = !heap.dirty_chunks.empty() ? heap.dirty_chunks : heap.clean_chunks;
+            if (pool.empty()) {
+                reserve_chunks();
+                return take_chunk_memory();
+            }
+
+            char* base = pool.back();
+            pool.pop_back();
+            return base;
+        }
+
+        HeapChunk* new_chunk(size_t class_index) {
+            char* base = take_chunk_memory();
+
+            auto* chunk = new HeapChunk {
+                base,
+                static_cast<uint32_t>(class_index),
+                HEAP_SIZE_CLASSES[class_index],
+                static_cast<uint32_t>(HEAP_CHUNK_SIZE / HEAP_SIZE_CLASSES[class_index])
+            };
+
+            auto& chunks = state().size_classes[class_index].chunks;
+            chunk->slot = static_cast<uint32_t>(chunks.size());
+            chunks.push_back(chunk);
+
+            state().chunk_table.store(reinterpret_cast<uintptr_t>(base), HEAP_CHUNK_SIZE, reinterpret_cast<uintptr_t>(chunk));
+            return chunk;
+        }
+
+        // chunk 的内存先留在 dirty 池里，等 heap_release_free_chunks 统一还给系统。
+        void release_chunk(HeapChunk* chunk) {
+            state().chunk_table.store(reinterpret_cast<uintptr_t>(chunk->base), HEAP_CHUNK_SIZE, 0);
+            state().dirty_chunks.push_back(chunk->base);
+            delete chunk;
+        }
+
+        // 从 size class 中摘除并归还一个 chunk：与末尾元素交换后弹出。
+        void remove_chunk(SizeClass& size_class, HeapChunk* chunk) {
+            HeapChunk* last = size_class.chunks.back();
+            size_class.chunks[chunk->slot] = last;
+            last->slot = chunk->slot;
+            size_class.chunks.pop_back();
+
+            release_chunk(chunk);
+        }
+
+        // 归还一个缓冲区租用的 chunk。剩余 cell 优先让 chunk 重新成为 bump chunk，
+        // 该 size class 已经有可用的 bump chunk 时则串进 free list。
+        void release_lease(GCAllocBuffer& buffer) {
+            auto* chunk = static_cast<HeapChunk*>(buffer.chunk);
+            SizeClass& size_class = state().size_classes[chunk->class_index];
+
+            state().buffered_bytes += static_cast<size_t>(buffer.cursor - cell_at(chunk, chunk->bump_index));
+            chunk->bump_index = static_cast<uint32_t>((buffer.cursor - chunk->base) / chunk->cell_size);
+            chunk->lease = nullptr;
+            buffer = {nullptr, nullptr, nullptr};
+
+            if (chunk->bump_index == chunk->cell_count) {
+                return;
+            }
+
+            HeapChunk* current = size_class.current;
+            if (!current || current->bump_index == current->cell_count) {
+                size_class.current = chunk;
+                return;
+            }
+
+            for (size_t i = chunk->cell_count; i-- > chunk->bump_index;) {
+                auto* cell = reinterpret_cast<FreeCell*>(cell_at(chunk, i));
+                cell->free_tag = nullptr;
+                cell->next = size_class.free_list;
+                size_class.free_list = cell;
+            }
+            chunk->bump_index = chunk->cell_count;
+        }
+
+        inline bool payload_contains(ObjectHeader* header, uintptr_t addr) {
+            auto begin = reinterpret_cast<uintptr_t>(header + 1);
+            return addr >= begin && addr < begin + header->obj_size;
+        }
+
+        ObjectHeader* find_large(uintptr_t addr) {
+            uintptr_t entry = state().chunk_table.load(addr);
+            if (!(entry & LARGE_ENTRY_TAG)) {
+                return nullptr;
+            }
+
+            auto* header = reinterpret_cast<ObjectHeader*>(entry & ~LARGE_ENTRY_TAG);
+            return payload_contains(header, addr) ? header : nullptr;
+        }
+
+        // 大对象各自占一段匿名映射，从不移动，回收时直接 munmap，物理页立即还给系统。
+        // 映射按 HEAP_CHUNK_SIZE 对齐，这样它覆盖的 chunk 表项只属于它自己。
+        ObjectHeader* alloc_large(size_t total_size, size_t& reserved_bytes) {
+            HeapState& heap = state();
+            reserved_bytes = large_mapping_size(total_size);
+
+            auto* header = reinterpret_cast<ObjectHeader*>(map_chunk_aligned(reserved_bytes));
+            heap.chunk_table.store(reinterpret_cast<uintptr_t>(header), reserved_bytes, reinterpret_cast<uintptr_t>(header) | LARGE_ENTRY_TAG);
+            heap.large_objects[reinterpret_cast<uintptr_t>(header)] = header;
+            heap.large_bytes += reserved_bytes;
+            return header;
+        }
+
+        // 归还一个大对象的映射，返回释放的字节数。调用方负责把它从 large_objects 中摘除。
+        size_t free_large(ObjectHeader* header) {
+            HeapState& heap = state();
+            size_t bytes = large_mapping_size(sizeof(ObjectHeader) + header->obj_size);
+
+            heap.chunk_table.store(reinterpret_cast<uintptr_t>(header), bytes, 0);
+            munmap(header, bytes);
+            heap.large_bytes -= bytes;
+            heap.released_bytes += bytes;
+            return bytes;
+        }
+
+        // 清扫单个 chunk：存活对象清 mark，死对象与原有空闲 cell 按地址顺序串进局部 free list。
+        // 返回该 chunk 中的存活对象数量。
+        size_t sweep_chunk(HeapChunk* chunk, FreeCell*& head, FreeCell*& tail, HeapSweepResult& result, bool keep_marks) {
+            size_t live = 0;
+            head = nullptr;
+            tail = nullptr;
+
+            for (size_t i = 0; i < chunk->sweep_limit; ++i) {
+                auto* header = reinterpret_cast<ObjectHeader*>(cell_at(chunk, i));
+
+                if (header->type_info) {
+                    if (test_mark(chunk, i)) {
+                        if (!keep_marks) {
+                            clear_mark(chunk, i);
+                        }
+                        ++live;
+                        continue;
+                    }
+
+                    result.freed_bytes += chunk->cell_size;
+                    ++result.freed_objects;
+                }
+
+                auto* cell = reinterpret_cast<FreeCell*>(header);
+                cell->free_tag = nullptr;
+                cell->next = nullptr;
+
+                if (tail) {
+                    tail->next = cell;
+                }
+                else {
+                    head = cell;
+                }
+                tail = cell;
+            }
+
+            return live;
+        }
+
+        // 清扫一个待清扫的 chunk，把空闲 cell 接到所属 size class 的 free list 前面。
+        void sweep_unswept_chunk(SizeClass& size_class, HeapChunk* chunk) {
+            HeapState& heap = state();
+            FreeCell* head = nullptr;
+            FreeCell* tail = nullptr;
+            HeapSweepResult result;
+
+            auto begin = std::chrono::steady_clock::now();
+            size_t live = sweep_chunk(chunk, head, tail, result, heap.sweep_keep_marks);
+            heap.sweep_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+            heap.swept_bytes += result.freed_bytes;
+            --heap.unswept_chunks;
+
+            // 整个 chunk 都空了，并且回收之后没有再从中分配：
+            // 当前 bump chunk 已满时直接接替它从头 bump，否则归还给系统。
+            if (live == 0 && chunk->bump_index == chunk->sweep_limit) {
+                HeapChunk* current = size_class.current;
+                chunk->sweep_limit = 0;
+
+                if (chunk == current || !current || current->bump_index == current->cell_count) {
+                    chunk->bump_index = 0;
+                    size_class.current = chunk;
+                }
+                else {
+                    remove_chunk(size_class, chunk);
+                }
+                return;
+            }
+
+            chunk->sweep_limit = 0;
+            if (head) {
+                tail->next = size_class.free_list;
+                size_class.free_list = head;
+            }
+        }
+
+        // chunk 中已分配的 cell 数。只在堆完整清扫之后有意义，此时已分配的都是存活对象。
+        size_t live_cells(HeapChunk* chunk) {
+            size_t live = 0;
+            for (size_t i = 0; i < chunk->bump_index; ++i) {
+                if (reinterpret_cast<ObjectHeader*>(cell_at(chunk, i))->type_info) {
+                    ++live;
+                }
+            }
+            return live;
+        }
+
+        // 按地址顺序重建一个 size class 的 free list。
+        void rebuild_free_list(SizeClass& size_class) {
+            size_class.free_list = nullptr;
+
+            for (size_t c = size_class.chunks.size(); c-- > 0;) {
+                HeapChunk* chunk = size_class.chunks[c];
+                for (size_t i = chunk->bump_index; i-- > 0;) {
+                    auto* cell = reinterpret_cast<FreeCell*>(cell_at(chunk, i));
+                    if (cell->free_tag) {
+                        continue;
+                    }
+                    cell->next = size_class.free_list;
+                    size_class.free_list = cell;
+                }
+            }
+        }
+
+        struct ChunkOccupancy {
+            HeapChunk* chunk;
+            size_t live;
+        };
+
+        // 搬迁一个 size class：chunk 按存活 cell 数从多到少排序，从前往后取作目标，从后往前取作源。
+        // 只有不到半满、且前面的目标 chunk 剩余的空闲 cell 放得下它全部存活对象的 chunk 才会被选为源。
+        void evacuate_class(SizeClass& size_class, const std::unordered_set<ObjectHeader*>& pinned, HeapEvacuationResult& result) {
+            std::vector<ChunkOccupancy> order;
+            for (HeapChunk* chunk : size_class.chunks) {
+                size_t live = live_cells(chunk);
+                // 空 chunk 留给之后的分配，既不搬也不作为目标。
+                if (live > 0) {
+                    order.push_back({ chunk, live });
+                }
+            }
+            if (order.size() < 2) {
+                return;
+            }
+
+            std::sort(order.begin(), order.end(), [](const ChunkOccupancy& lhs, const ChunkOccupancy& rhs) {
+                return lhs.live > rhs.live;
+            });
+
+            size_t source_begin = order.size();
+            size_t target_end = 0;
+            size_t target_free = 0;
+            while (source_begin > 1) {
+                const ChunkOccupancy& source = order[source_begin - 1];
+                if (source.live * 2 >= source.chunk->cell_count) {
+                    break;
+                }
+
+                while (target_free < source.live && target_end < source_begin - 1) {
+                    target_free += order[target_end].chunk->cell_count - order[target_end].live;
+                    ++target_end;
+                }
+                if (target_free < source.live) {
+                    break;
+                }
+
+                target_free -= source.live;
+                --source_begin;
+            }
+            if (source_begin == order.size()) {
+                return;
+            }
+
+            // 目标 cell 按顺序取自 order[0, source_begin)：已切分范围内的空闲 cell，或者 bump 区的下一个 cell。
+            size_t target = 0;
+            size_t target_cell = 0;
+            auto next_target = [&]() -> ObjectHeader* {
+                for (; target < source_begin; ++target, target_cell = 0) {
+                    HeapChunk* chunk = order[target].chunk;
+                    while (target_cell < chunk->cell_count) {
+                        size_t index = target_cell++;
+                        auto* header = reinterpret_cast<ObjectHeader*>(cell_at(chunk, index));
+                        if (index >= chunk->bump_index) {
+                            chunk->bump_index = static_cast<uint32_t>(index + 1);
+                            return header;
+                        }
+                        if (!header->type_info) {
+                            return header;
+                        }
+                    }
+                }
+                return nullptr;
+            };
+
+            // 目标 cell 被覆盖后原有的 free list 就失效了，heap_end_evacuation 会重建它。
+            size_class.free_list = nullptr;
+
+            for (size_t s = source_begin; s < order.size(); ++s) {
+                HeapChunk* chunk = order[s].chunk;
+                chunk->forwarding = std::make_unique<ObjectHeader*[]>(chunk->cell_count);
+                state().evacuated.push_back(chunk);
+
+                for (size_t i = 0; i < chunk->bump_index; ++i) {
+                    auto* header = reinterpret_cast<ObjectHeader*>(cell_at(chunk, i));
+                    if (!header->type_info || pinned.contains(header)) {
+                        continue;
+                    }
+
+                    ObjectHeader* moved = next_target();
+                    if (!moved) {
+                        return;
+                    }
+
+                    std::memcpy(moved, header, sizeof(ObjectHeader) + header->obj_size);
+                    chunk->forwarding[i] = moved;
+                    header->type_info = nullptr;
+
+                    result.moved_bytes += chunk->cell_size;
+                    ++result.moved_objects;
+                }
+            }
+        }
+
+        bool sweep_class_one(SizeClass& size_class) {
+            if (size_class.unswept.empty()) {
+                return false;
+            }
+
+            HeapChunk* chunk = size_class.unswept.back();
+            size_class.unswept.pop_back();
+            sweep_unswept_chunk(size_class, chunk);
+            return true;
+        }
+
+        // 分配走到慢路径时顺带清扫其他 size class 的一个 chunk，
+        // 保证很少分配的 size class 也会在下一次回收前被清扫完。
+        void sweep_some_class() {
+            HeapState& heap = state();
+            if (heap.unswept_chunks == 0) {
+                return;
+            }
+
+            for (size_t i = 0; i < heap.size_classes.size(); ++i) {
+                heap.sweep_cursor = (heap.sweep_cursor + 1) % heap.size_classes.size();
+                if (sweep_class_one(heap.size_classes[heap.sweep_cursor])) {
+                    return;
+                }
+            }
+        }
+    }
+
+    ObjectHeader* heap_alloc(size_t total_size, size_t& reserved_bytes) {
+        if (total_size > HEAP_MAX_SMALL_SIZE) {
+            return alloc_large(total_size, reserved_bytes);
+        }
+
+        size_t class_index = class_index_of(total_size);
+        SizeClass& size_class = state().size_classes[class_index];
+        reserved_bytes = HEAP_SIZE_CLASSES[class_index];
+
+        if (FreeCell* cell = size_class.free_list) {
+            size_class.free_list = cell->next;
+            return reinterpret_cast<ObjectHeader*>(cell);
+        }
+
+        // free list 用完时先惰性清扫本 size class 的 chunk，清扫出空闲 cell 或可以 bump 的 chunk 就停下。
+        // 每次分配最多清扫 MAX_LAZY_SWEEP_CHUNKS 个 chunk，避免整块存活的 chunk 让单次分配变慢。
+        for (size_t swept = 0; swept < MAX_LAZY_SWEEP_CHUNKS && sweep_class_one(size_class); ++swept) {
+            if (FreeCell* cell = size_class.free_list) {
+                size_class.free_list = cell->next;
+                return reinterpret_cast<ObjectHeader*>(cell);
+            }
+
+            HeapChunk* current = size_class.current;
+            if (current && current->bump_index < current->cell_count) {
+                break;
+            }
+        }
+
+        sweep_some_class();
+
+        HeapChunk* chunk = size_class.current;
+        if (!chunk || chunk->bump_index == chunk->cell_count) {
+            chunk = new_chunk(class_index);
+            size_class.current = chunk;
+        }
+
+        return reinterpret_cast<ObjectHeader*>(cell_at(chunk, chunk->bump_index++));
+    }
+
+    ObjectHeader* heap_find(void* addr) {
+        if (!addr) {
+            return nullptr;
+        }
+
+        auto value = reinterpret_cast<uintptr_t>(addr);
+
+        if (HeapChunk* chunk = chunk_of(value)) {
+            size_t index = cell_index(chunk, value);
+            if (index >= used_cells(chunk)) {
+                return nullptr;
+            }
+
+            auto* header = reinterpret_cast<ObjectHeader*>(cell_at(chunk, index));
+            if (!header->type_info || !payload_contains(header, value)) {
+                return nullptr;
+            }
+            return header;
+        }
+
+        return find_large(value);
+    }
+
+    ObjectHeader* heap_find_live(void* addr) {
+        if (!addr) {
+            return nullptr;
+        }
+
+        auto value = reinterpret_cast<uintptr_t>(addr);
+
+        // 不比较 used_cells：租用中的 chunk 的切分进度在其他线程的分配缓冲区里，不持锁读不到可靠的值。
+        // addr 落在存活对象里时，它的 cell 一定已经切分出去。
+        if (HeapChunk* chunk = chunk_of(value)) {
+            size_t index = cell_index(chunk, value);
+            if (index >= chunk->cell_count) {
+                return nullptr;
+            }
+
+            auto* header = reinterpret_cast<ObjectHeader*>(cell_at(chunk, index));
+            if (!header->type_info || !payload_contains(header, value)) {
+                return nullptr;
+            }
+            return header;
+        }
+
+        return find_large(value);
+    }
+
+    // 不持锁的 write barrier 会读 bitmap，增量标记期间其他线程分配时会持锁给新对象置位，
+    // 所以这两处对 bitmap 的读写都是原子的。
+    bool heap_is_marked(ObjectHeader* header) {
+        auto value = reinterpret_cast<uintptr_t>(header);
+        if (HeapChunk* chunk = chunk_of(value)) {
+            size_t index = cell_index(chunk, value);
+            std::atomic_ref<uint64_t> word(chunk->mark_bits[index / 64]);
+            return (word.load(std::memory_order_relaxed) >> (index % 64)) & 1;
+        }
+        return header->mark == Marked;
+    }
+
+    void heap_set_marked(ObjectHeader* header, bool marked) {
+        auto value = reinterpret_cast<uintptr_t>(header);
+        if (HeapChunk* chunk = chunk_of(value)) {
+            if (marked) {
+                size_t index = cell_index(chunk, value);
+                std::atomic_ref<uint64_t> word(chunk->mark_bits[index / 64]);
+                word.fetch_or(uint64_t(1) << (index % 64), std::memory_order_relaxed);
+            }
+            else {
+                clear_mark(chunk, cell_index(chunk, value));
+            }
+            return;
+        }
+        header->mark = marked ? Marked : Unmarked;
+    }
+
+    ObjectHeader* heap_mark_claim(void* addr, bool atomic) {
+        if (!addr) {
+            return nullptr;
+        }
+
+        auto value = reinterpret_cast<uintptr_t>(addr);
+
+        if (HeapChunk* chunk = chunk_of(value)) {
+            size_t index = cell_index(chunk, value);
+            if (index >= used_cells(chunk)) {
+                return nullptr;
+            }
+
+            uint64_t& word = chunk->mark_bits[index / 64];
+            uint64_t bit = uint64_t(1) << (index % 64);
+            std::atomic_ref<uint64_t> shared_word(word);
+
+            // 先只看 bitmap：已经标记过的对象（多数是被多处引用的对象）不必再读对象头。
+            if (shared_word.load(std::memory_order_relaxed) & bit) {
+                return nullptr;
+            }
+
+            auto* header = reinterpret_cast<ObjectHeader*>(cell_at(chunk, index));
+            if (!header->type_info || !payload_contains(header, value)) {
+                return nullptr;
+            }
+
+            if (atomic) {
+                return (shared_word.fetch_or(bit, std::memory_order_acq_rel) & bit) ? nullptr : header;
+            }
+
+            word |= bit;
+            return header;
+        }
+
+        ObjectHeader* header = find_large(value);
+        if (!header) {
+            return nullptr;
+        }
+
+        std::atomic_ref<GCMark> mark(header->mark);
+        if (mark.load(std::memory_order_relaxed) == Marked) {
+            return nullptr;
+        }
+        if (atomic) {
+            return mark.exchange(Marked, std::memory_order_acq_rel) != Marked ? header : nullptr;
+        }
+
+        header->mark = Marked;
+        return header;
+    }
+
+    ObjectHeader* heap_buffer_alloc(GCAllocBuffer* buffers, size_t total_size) {
+        if (total_size > HEAP_MAX_SMALL_SIZE) {
+            return nullptr;
+        }
+
+        size_t class_index = class_index_of(total_size);
+        GCAllocBuffer& buffer = buffers[class_index];
+        if (static_cast<size_t>(buffer.limit - buffer.cursor) < HEAP_SIZE_CLASSES[class_index]) {
+            return nullptr;
+        }
+
+        auto* header = reinterpret_cast<ObjectHeader*>(buffer.cursor);
+        buffer.cursor += HEAP_SIZE_CLASSES[class_index];
+        return header;
+    }
+
+    void heap_arm_alloc_buffer(GCAllocBuffer* buffers, size_t total_size, size_t budget) {
+        if (total_size > HEAP_MAX_SMALL_SIZE) {
+            return;
+        }
+
+        size_t class_index = class_index_of(total_size);
+        SizeClass& size_class = state().size_classes[class_index];
+        GCAllocBuffer& buffer = buffers[class_index];
+
+        HeapChunk* chunk = size_class.current;
+        if (buffer.chunk || size_class.free_list || !size_class.unswept.empty() || !chunk) {
+            return;
+        }
+
+        size_t cells = std::min<size_t>(chunk->cell_count - chunk->bump_index, budget / chunk->cell_size);
+        if (cells == 0) {
+            return;
+        }
+
+        // 租出去的 chunk 不再是 bump chunk，其他线程的慢路径会另找 chunk。
+        chunk->lease = &buffer;
+        size_class.current = nullptr;
+
+        buffer.cursor = cell_at(chunk, chunk->bump_index);
+        buffer.limit = buffer.cursor + cells * chunk->cell_size;
+        buffer.chunk = chunk;
+    }
+
+    void heap_return_alloc_buffer(GCAllocBuffer* buffers, size_t total_size) {
+        if (total_size > HEAP_MAX_SMALL_SIZE) {
+            return;
+        }
+
+        GCAllocBuffer& buffer = buffers[class_index_of(total_size)];
+        if (buffer.chunk) {
+            release_lease(buffer);
+        }
+    }
+
+    void heap_flush_alloc_buffers(GCAllocBuffer* buffers) {
+        for (size_t i = 0; i < HEAP_SIZE_CLASS_COUNT; ++i) {
+            if (buffers[i].chunk) {
+                release_lease(buffers[i]);
+            }
+        }
+    }
+
+    size_t heap_take_buffered_bytes() {
+        size_t bytes = state().buffered_bytes;
+        state().buffered_bytes = 0;
+        return bytes;
+    }
+
+    HeapSweepResult heap_begin_sweep(bool keep_marks) {
+        HeapSweepResult result;
+        HeapState& heap = state();
+
+        heap.sweep_keep_marks = keep_marks;
+        heap.unswept_chunks = 0;
+
+        // 原有的 free list 全部作废：空闲 cell 的 type_info 为空，清扫对应 chunk 时会被重新收集。
+        for (auto& size_class : heap.size_classes) {
+            size_class.free_list = nullptr;
+            size_class.unswept.clear();
+
+            for (HeapChunk* chunk : size_class.chunks) {
+                chunk->sweep_limit = chunk->bump_index;
+                if (chunk->sweep_limit > 0) {
+                    size_class.unswept.push_back(chunk);
+                    ++heap.unswept_chunks;
+                }
+            }
+        }
+
+        auto it = heap.large_objects.begin();
+        while (it != heap.large_objects.end()) {
+            ObjectHeader* header = it->second;
+
+            if (header->mark == Marked) {
+                if (!keep_marks) {
+                    header->mark = Unmarked;
+                }
+                ++it;
+                continue;
+            }
+
+            it = heap.large_objects.erase(it);
+            result.freed_bytes += free_large(header);
+            ++result.freed_objects;
+        }
+
+        return result;
+    }
+
+    void heap_finish_sweep() {
+        HeapState& heap = state();
+        if (heap.unswept_chunks == 0) {
+            return;
+        }
+
+        for (auto& size_class : heap.size_classes) {
+            while (sweep_class_one(size_class)) {}
+        }
+    }
+
+    bool heap_sweep_pending() {
+        return state().unswept_chunks > 0;
+    }
+
+    size_t heap_take_swept_bytes() {
+        size_t bytes = state().swept_bytes;
+        state().swept_bytes = 0;
+        return bytes;
+    }
+
+    uint64_t heap_take_sweep_ns() {
+        uint64_t ns = state().sweep_ns;
+        state().sweep_ns = 0;
+        return ns;
+    }
+
+    void heap_clear_marks() {
+        HeapState& heap = state();
+
+        // 未清扫 chunk 里的死对象只靠“未标记”来识别，清 mark 之前必须先把它们清扫掉。
+        heap_finish_sweep();
+
+        // 空闲 cell 的 mark 位本来就是 0，整块清零即可，不用逐个访问对象。
+        for (auto& size_class : heap.size_classes) {
+            for (HeapChunk* chunk : size_class.chunks) {
+                chunk->mark_bits.fill(0);
+            }
+        }
+
+        for (auto& [_, header] : heap.large_objects) {
+            header->mark = Unmarked;
+        }
+    }
+
+    double heap_fragmentation() {
+        size_t capacity = 0;
+        size_t live = 0;
+
+        for (auto& size_class : state().size_classes) {
+            for (HeapChunk* chunk : size_class.chunks) {
+                size_t marked = 0;
+                for (uint64_t word : chunk->mark_bits) {
+                    marked += std::popcount(word);
+                }
+                capacity += HEAP_CHUNK_SIZE;
+                live += marked * chunk->cell_size;
+            }
+        }
+
+        return capacity == 0 ? 0.0 : 1.0 - static_cast<double>(live) / static_cast<double>(capacity);
+    }
+
+    HeapEvacuationResult heap_evacuate(const std::unordered_set<ObjectHeader*>& pinned) {
+        HeapEvacuationResult result;
+        for (auto& size_class : state().size_classes) {
+            evacuate_class(size_class, pinned, result);
+        }
+        return result;
+    }
+
+    void* heap_forward(void* addr) {
+        if (!addr || state().evacuated.empty()) {
+            return addr;
+        }
+
+        auto value = reinterpret_cast<uintptr_t>(addr);
+        HeapChunk* chunk = chunk_of(value);
+        if (!chunk || !chunk->forwarding) {
+            return addr;
+        }
+
+        size_t index = cell_index(chunk, value);
+        if (index >= chunk->cell_count || !chunk->forwarding[index]) {
+            return addr;
+        }
+
+        auto offset = value - reinterpret_cast<uintptr_t>(cell_at(chunk, index));
+        return reinterpret_cast<char*>(chunk->forwarding[index]) + offset;
+    }
+
+    void heap_for_each_object(void (*visit)(ObjectHeader*, void*), void* context) {
+        HeapState& heap = state();
+
+        for (auto& size_class : heap.size_classes) {
+            for (HeapChunk* chunk : size_class.chunks) {
+                for (size_t i = 0; i < used_cells(chunk); ++i) {
+                    auto* header = reinterpret_cast<ObjectHeader*>(cell_at(chunk, i));
+                    if (header->type_info) {
+                        visit(header, context);
+                    }
+                }
+            }
+        }
+
+        for (auto& [_, header] : heap.large_objects) {
+            visit(header, context);
+        }
+    }
+
+    void heap_end_evacuation() {
+        HeapState& heap = state();
+        std::array<bool, HEAP_SIZE_CLASS_COUNT> touched {};
+
+        for (HeapChunk* chunk : heap.evacuated) {
+            SizeClass& size_class = heap.size_classes[chunk->class_index];
+            touched[chunk->class_index] = true;
+            chunk->forwarding.reset();
+
+            // 被 pin 住的对象让 chunk 留下来，它的空闲 cell 随 free list 重建重新可用。
+            if (live_cells(chunk) == 0) {
+                if (size_class.current == chunk) {
+                    size_class.current = nullptr;
+                }
+                remove_chunk(size_class, chunk);
+            }
+        }
+        heap.evacuated.clear();
+
+        for (size_t i = 0; i < HEAP_SIZE_CLASS_COUNT; ++i) {
+            if (touched[i]) {
+                rebuild_free_list(heap.size_classes[i]);
+            }
+        }
+    }
+
+    size_t heap_free_object(ObjectHeader* header) {
+        HeapState& heap = state();
+        auto addr = reinterpret_cast<uintptr_t>(header);
+
+        if (HeapChunk* chunk = chunk_of(addr)) {
+            clear_mark(chunk, cell_index(chunk, addr));
+
+            auto* cell = reinterpret_cast<FreeCell*>(header);
+            cell->free_tag = nullptr;
+            cell->next = heap.size_classes[chunk->class_index].free_list;
+            heap.size_classes[chunk->class_index].free_list = cell;
+            return chunk->cell_size;
+        }
+
+        heap.large_objects.erase(addr);
+        return free_large(header);
+    }
+
+    size_t heap_release_free_chunks() {
+        HeapState& heap = state();
+        size_t released = 0;
+
+        // MADV_DONTNEED 之后这段地址仍然有效，再次访问时内核按需补上清零的页。
+        // 按地址排序后把相邻的 chunk 合并成一次系统调用。
+        std::vector<char*>& dirty = heap.dirty_chunks;
+        std::sort(dirty.begin(), dirty.end());
+        for (size_t begin = 0; begin < dirty.size();) {
+            size_t end = begin + 1;
+            while (end < dirty.size() && dirty[end] == dirty[end - 1] + HEAP_CHUNK_SIZE) {
+                ++end;
+            }
+
+            madvise(dirty[begin], (end - begin) * HEAP_CHUNK_SIZE, MADV_DONTNEED);
+            released += (end - begin) * HEAP_CHUNK_SIZE;
+            begin = end;
+        }
+
+        // clean 池按栈使用，倒序放入让低地址先被取走。
+        heap.clean_chunks.insert(heap.clean_chunks.end(), dirty.rbegin(), dirty.rend());
+        dirty.clear();
+
+        heap.released_bytes += released;
+        return released;
+    }
+
+    size_t heap_large_object_bytes() {
+        return state().large_bytes;
+    }
+
+    size_t heap_released_bytes() {
+        return state().released_bytes;
+    }
+
+    void heap_release_all() {
+        HeapState& heap = state();
+
+        heap.buffered_bytes = 0;
+
+        for (auto& size_class : heap.size_classes) {
+            for (HeapChunk* chunk : size_class.chunks) {
+                if (chunk->lease) {
+                    *chunk->lease = {nullptr, nullptr, nullptr};
+                }
+                release_chunk(chunk);
+            }
+            size_class.chunks.clear();
+            size_class.unswept.clear();
+            size_class.free_list = nullptr;
+            size_class.current = nullptr;
+        }
+        heap.unswept_chunks = 0;
+
+        for (auto& [_, header] : heap.large_objects) {
+            size_t bytes = large_mapping_size(sizeof(ObjectHeader) + header->obj_size);
+            heap.chunk_table.store(reinterpret_cast<uintptr_t>(header), bytes, 0);
+            munmap(header, bytes);
+        }
+        heap.large_objects.clear();
+        heap.large_bytes = 0;
+
+        for (auto& [base, bytes] : heap.chunk_regions) {
+            munmap(base, bytes);
+        }
+        heap.chunk_regions.clear();
+        heap.dirty_chunks.clear();
+        heap.clean_chunks.clear();
+    }
+}
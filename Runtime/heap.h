@@ -0,0 +1,166 @@
+/*
+    SakuraE Runtime Library
+    heap.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_HEAP_H
+#define SAKURAE_RUNTIME_HEAP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+
+#include "gc.h"
+
+namespace sakuraE::runtime {
+    // GC 自有堆：小对象按 size class 放进对齐的 chunk，每个 chunk 只切一种大小的 cell；
+    // 超过 HEAP_MAX_SMALL_SIZE 的对象进入大对象空间，每个对象单独 mmap 一段按页取整的内存。
+    // chunk 与大对象都直接向系统映射内存，不经过 malloc。
+    constexpr size_t HEAP_CHUNK_SHIFT = 16;
+    constexpr size_t HEAP_CHUNK_SIZE = size_t(1) << HEAP_CHUNK_SHIFT;
+    constexpr size_t HEAP_MAX_SMALL_SIZE = 8192;
+
+    // size class 以“header + payload”的总大小计，间隔大约是 2 的幂的 1/4，
+    // 因此内部碎片最多在 25% 左右。codegen 也据此在编译期为内联分配选出 size class。
+    constexpr std::array<uint32_t, 32> HEAP_SIZE_CLASSES = {
+        16, 32, 48, 64, 80, 96, 112, 128,
+        160, 192, 224, 256,
+        320, 384, 448, 512,
+        640, 768, 896, 1024,
+        1280, 1536, 1792, 2048,
+        2560, 3072, 3584, 4096,
+        5120, 6144, 7168, 8192
+    };
+
+    static_assert(HEAP_SIZE_CLASSES.back() == HEAP_MAX_SMALL_SIZE);
+
+    constexpr size_t HEAP_SIZE_CLASS_COUNT = HEAP_SIZE_CLASSES.size();
+
+    // total_size 不超过 HEAP_MAX_SMALL_SIZE 时所属的 size class 下标。
+    constexpr size_t heap_size_class_index(size_t total_size) {
+        size_t cls = 0;
+        while (HEAP_SIZE_CLASSES[cls] < total_size) {
+            ++cls;
+        }
+        return cls;
+    }
+
+    // 分配缓冲区：每个 mutator 线程、每个 size class 一个，独占（租用）一个 chunk 中尚未切分的 cell。
+    // 生成代码和 __gc_alloc 的快路径只需比较并推进 cursor，缓冲区为空（cursor == limit）时走慢路径。
+    // 租用期间其他线程不会从这个 chunk 分配，因此快路径不需要任何同步。
+    struct GCAllocBuffer {
+        char* cursor;
+        char* limit;
+        // 租用的 chunk，由 heap.cpp 解释。
+        void* chunk;
+    };
+
+    struct HeapSweepResult {
+        size_t freed_bytes = 0;
+        size_t freed_objects = 0;
+    };
+
+    struct HeapEvacuationResult {
+        size_t moved_bytes = 0;
+        size_t moved_objects = 0;
+    };
+
+    // 分配一块至少 total_size 字节（含 header）的内存，header 由调用方填写。
+    // 返回的 reserved_bytes 是实际占用的字节数，用于 allocated_bytes 记账。
+    ObjectHeader* heap_alloc(size_t total_size, size_t& reserved_bytes);
+
+    // 从 buffers 中对应 size class 的缓冲区里切出一个 cell，缓冲区用完时返回 nullptr。
+    ObjectHeader* heap_buffer_alloc(GCAllocBuffer* buffers, size_t total_size);
+
+    // 让 buffers 中对应 size class 的缓冲区租下该 class 当前 chunk 的剩余部分，最多 budget 字节。
+    // 只有缓冲区空闲、free list 为空且没有待清扫 chunk 时才会启用，与慢路径“先复用、再 bump”的顺序保持一致。
+    void heap_arm_alloc_buffer(GCAllocBuffer* buffers, size_t total_size, size_t budget);
+
+    // 归还 buffers 中对应 size class 的缓冲区租用的 chunk。快路径用完缓冲区进入慢路径时先调用，
+    // 这样 chunk 剩余的 cell 能重新被分配，快路径分配的字节也能赶在 limit 检查之前记账。
+    void heap_return_alloc_buffer(GCAllocBuffer* buffers, size_t total_size);
+
+    // 归还 buffers 租用的全部 chunk，把已经切出去的 cell 写回 chunk。
+    // 开始清扫、清除 mark 之前必须先对所有线程调用，堆遍历只认 chunk 自己的 bump_index。
+    void heap_flush_alloc_buffers(GCAllocBuffer* buffers);
+
+    // 取走缓冲区收回时统计到的、自上次调用以来经快路径分配的字节数。
+    size_t heap_take_buffered_bytes();
+
+    // 把任意地址（包括 interior pointer）解析到宿主对象，不属于 GC 堆时返回 nullptr。
+    ObjectHeader* heap_find(void* addr);
+
+    // 不持有 GC 锁的 heap_find，供 write barrier 的快路径使用。addr 必须落在调用方确定存活的对象里，
+    // 或者根本不属于 GC 堆：存活对象所在的 chunk 和大对象映射不会在查找期间被归还。
+    ObjectHeader* heap_find_live(void* addr);
+
+    // 小对象的 mark 不写在对象头里，而是放在所属 chunk 的 side bitmap 中（每个 cell 一位），
+    // 标记阶段只写这些紧凑的 bitmap，不会弄脏存放对象的页；大对象仍使用 ObjectHeader::mark。
+    // 空闲和尚未切分的 cell 的 mark 位恒为 0，因此快路径分配不需要碰 bitmap。
+    bool heap_is_marked(ObjectHeader* header);
+    void heap_set_marked(ObjectHeader* header, bool marked);
+
+    // 把 addr 解析到宿主对象并标记它，只有真正完成 Unmarked -> Marked 转换的调用返回该对象，
+    // 地址不属于 GC 堆或对象已经被标记时返回 nullptr。已标记的对象只查 bitmap，不读对象头。
+    // atomic 为 true 时用原子操作置位，供多个并行标记 worker 同时调用。
+    ObjectHeader* heap_mark_claim(void* addr, bool atomic);
+
+    // 开始一轮惰性清扫：大对象当场回收，小对象 chunk 只登记为待清扫，
+    // 之后由对应 size class 的分配慢路径逐个清扫，停顿中不再遍历整个堆。
+    // keep_marks 为 false 时顺带清除存活对象的 mark；分代模式下存活对象保持 Marked，表示已晋升为老对象。
+    // 返回值只包含当场回收的大对象。
+    HeapSweepResult heap_begin_sweep(bool keep_marks = false);
+
+    // 立即清扫所有待清扫的 chunk。下一轮标记开始前必须调用，因为未清扫 chunk 里的存活对象还带着旧的 mark。
+    void heap_finish_sweep();
+
+    // 是否还有待清扫的 chunk。
+    bool heap_sweep_pending();
+
+    // 取走惰性清扫自上次调用以来归还的字节数。
+    size_t heap_take_swept_bytes();
+
+    // 取走惰性清扫自上次调用以来花费的纳秒数，供 GC 统计使用。
+    uint64_t heap_take_sweep_ns();
+
+    // 清除堆上所有对象的 mark，分代模式的 full collection 在标记前调用。
+    void heap_clear_marks();
+
+    // 标记完成、清扫开始之前调用：小对象 chunk 中没有被存活对象占用的比例，由 mark bitmap 算出。
+    double heap_fragmentation();
+
+    // 压缩：把稀疏 chunk 里的存活小对象搬进同一 size class 中更满的 chunk 的空闲 cell。
+    // 调用前堆必须已经完整清扫，且所有分配缓冲区都已归还；pinned 中的对象留在原处。
+    // 只在目标 chunk 放得下时才会选中源 chunk，因此不会为了搬迁申请新 chunk。大对象从不移动。
+    HeapEvacuationResult heap_evacuate(const std::unordered_set<ObjectHeader*>& pinned);
+
+    // 把指向已搬走对象（包括其内部）的指针换成新地址，其他指针原样返回。
+    void* heap_forward(void* addr);
+
+    // 依次访问堆上的每个对象。只在堆完整清扫之后调用，此时访问到的都是存活对象。
+    void heap_for_each_object(void (*visit)(ObjectHeader*, void*), void* context);
+
+    // 所有指针都已更新之后调用：归还已经搬空的 chunk，重建受影响 size class 的 free list。
+    void heap_end_evacuation();
+
+    // 把清扫和压缩腾出的空闲 chunk 通过 madvise 还给系统，地址空间保留下来供之后复用。
+    // 返回本次归还的字节数。每轮回收清扫完成后调用。
+    size_t heap_release_free_chunks();
+
+    // 大对象空间当前占用的字节数（按页取整）。
+    size_t heap_large_object_bytes();
+    // 累计还给系统的字节数：madvise 掉的空闲 chunk 加上 munmap 掉的大对象。
+    size_t heap_released_bytes();
+
+    // 单独回收一个对象，返回归还的字节数。minor collection 据此只清扫 young 对象。
+    size_t heap_free_object(ObjectHeader* header);
+
+    // 进程退出时解除全部 chunk 与大对象的映射。
+    void heap_release_all();
+}
+
+#endif // !SAKURAE_RUNTIME_HEAP_H
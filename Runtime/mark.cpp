@@ -0,0 +1,399 @@
+/*
+    SakuraE Runtime Library
+    mark.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "mark.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "heap.h"
+
+namespace sakuraE::runtime {
+    namespace {
+        // 私有 mark stack 超过该长度时，把底部一半挪进可被窃取的共享队列。
+        constexpr size_t SHARE_THRESHOLD = 256;
+
+        // 预取 FIFO 的深度：大致等于一次 cache miss 期间能处理完的对象数。
+        constexpr size_t PREFETCH_DISTANCE = 8;
+
+        // 连续存储、按需倍增的 mark stack。
+        // 出栈的对象先进入一个 PREFETCH_DISTANCE 深的环形 FIFO 并预取它的对象头，
+        // 交给标记循环的是 FIFO 里最早进入的那个，等轮到它时对象头多半已经在缓存里，
+        // 标记循环因此不必每个对象都等一次内存延迟。
+        class MarkStack {
+        public:
+            // 栈本体，push_visit 把整段搬进共享队列时直接操作它。
+            std::vector<void*> items;
+
+            void push(void* obj) {
+                items.push_back(obj);
+            }
+
+            bool pop(void*& out) {
+                while (count < PREFETCH_DISTANCE && !items.empty()) {
+                    void* obj = items.back();
+                    items.pop_back();
+
+                    // 精确指针指向 payload，对象头就在它前面；interior pointer 预取错了也无害。
+                    __builtin_prefetch(static_cast<char*>(obj) - sizeof(ObjectHeader));
+                    fifo[(head + count) % PREFETCH_DISTANCE] = obj;
+                    ++count;
+                }
+
+                if (count == 0) {
+                    return false;
+                }
+
+                out = fifo[head];
+                head = (head + 1) % PREFETCH_DISTANCE;
+                --count;
+                return true;
+            }
+
+            bool empty() const {
+                return items.empty() && count == 0;
+            }
+
+            // 取出全部剩余对象（包括 FIFO 中的），追加到 out。
+            void take_all(std::vector<void*>& out) {
+                out.insert(out.end(), items.begin(), items.end());
+                for (; count > 0; --count) {
+                    out.push_back(fifo[head]);
+                    head = (head + 1) % PREFETCH_DISTANCE;
+                }
+                items.clear();
+            }
+
+            void release() {
+                items.clear();
+                items.shrink_to_fit();
+                head = 0;
+                count = 0;
+            }
+
+        private:
+            std::array<void*, PREFETCH_DISTANCE> fifo {};
+            size_t head = 0;
+            size_t count = 0;
+        };
+
+        void push_grey(void* obj, void* context) {
+            if (obj && context) {
+                static_cast<MarkStack*>(context)->push(obj);
+            }
+        }
+
+        struct MarkWorker {
+            // 只有所属线程访问的私有 mark stack，热路径上不加锁。
+            MarkStack local;
+            // 对其他 worker 可见的共享队列：所属线程从尾部取，窃取者从头部取。
+            std::mutex shared_lock;
+            std::deque<void*> shared;
+            std::atomic<size_t> shared_size {0};
+        };
+
+        inline char* payload_of(ObjectHeader* header) {
+            return reinterpret_cast<char*>(header + 1);
+        }
+
+        class MarkPool {
+        public:
+            ~MarkPool() {
+                shutdown();
+            }
+
+            void run(const std::vector<void*>& seeds, uint32_t threads) {
+                ensure_workers(threads);
+
+                for (size_t i = 0; i < seeds.size(); ++i) {
+                    MarkWorker& worker = *workers[i % active];
+                    worker.shared.push_back(seeds[i]);
+                }
+                for (uint32_t i = 0; i < active; ++i) {
+                    workers[i]->shared_size.store(workers[i]->shared.size(), std::memory_order_relaxed);
+                }
+
+                idle.store(0, std::memory_order_relaxed);
+
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    finished = 0;
+                    ++epoch;
+                }
+                wake.notify_all();
+
+                // 发起回收的线程本身充当 0 号 worker。
+                drain(0);
+
+                std::unique_lock<std::mutex> guard(lock);
+                all_done.wait(guard, [&] { return finished == active - 1; });
+            }
+
+            void shutdown() {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    stopping = true;
+                    ++epoch;
+                }
+                wake.notify_all();
+
+                for (auto& thread : helpers) {
+                    thread.join();
+                }
+
+                helpers.clear();
+                workers.clear();
+                active = 0;
+                stopping = false;
+            }
+
+        private:
+            std::vector<std::unique_ptr<MarkWorker>> workers;
+            std::vector<std::thread> helpers;
+            uint32_t active = 0;
+
+            std::mutex lock;
+            std::condition_variable wake;
+            std::condition_variable all_done;
+            uint64_t epoch = 0;
+            uint32_t finished = 0;
+            bool stopping = false;
+
+            // 处于空闲（找不到任务）状态的 worker 数量，等于 active 时标记结束。
+            std::atomic<uint32_t> idle {0};
+
+            void ensure_workers(uint32_t threads) {
+                if (threads == active) {
+                    return;
+                }
+
+                shutdown();
+
+                active = threads;
+                for (uint32_t i = 0; i < active; ++i) {
+                    workers.push_back(std::make_unique<MarkWorker>());
+                }
+
+                // 新线程从创建时的 epoch 开始等待，避免错过紧接着发起的第一轮标记。
+                uint64_t start_epoch = epoch;
+                for (uint32_t i = 1; i < active; ++i) {
+                    helpers.emplace_back([this, i, start_epoch] { helper_loop(i, start_epoch); });
+                }
+            }
+
+            void helper_loop(uint32_t id, uint64_t seen) {
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> guard(lock);
+                        wake.wait(guard, [&] { return epoch != seen; });
+                        seen = epoch;
+                        if (stopping) {
+                            return;
+                        }
+                    }
+
+                    drain(id);
+
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        ++finished;
+                    }
+                    all_done.notify_one();
+                }
+            }
+
+            static void push_visit(void* obj, void* context) {
+                if (!obj || !context) {
+                    return;
+                }
+
+                auto* worker = static_cast<MarkWorker*>(context);
+                std::vector<void*>& local = worker->local.items;
+                local.push_back(obj);
+
+                // 私有栈积压过多且共享队列已空时，分出底部一半供其他 worker 窃取。
+                if (local.size() > SHARE_THRESHOLD &&
+                    worker->shared_size.load(std::memory_order_relaxed) == 0) {
+                    size_t half = local.size() / 2;
+
+                    std::lock_guard<std::mutex> guard(worker->shared_lock);
+                    worker->shared.insert(worker->shared.end(), local.begin(), local.begin() + half);
+                    worker->shared_size.store(worker->shared.size(), std::memory_order_release);
+                    local.erase(local.begin(), local.begin() + half);
+                }
+            }
+
+            bool pop_shared(MarkWorker& worker, bool from_back, void*& out) {
+                if (worker.shared_size.load(std::memory_order_acquire) == 0) {
+                    return false;
+                }
+
+                std::lock_guard<std::mutex> guard(worker.shared_lock);
+                if (worker.shared.empty()) {
+                    return false;
+                }
+
+                if (from_back) {
+                    out = worker.shared.back();
+                    worker.shared.pop_back();
+                }
+                else {
+                    out = worker.shared.front();
+                    worker.shared.pop_front();
+                }
+                worker.shared_size.store(worker.shared.size(), std::memory_order_release);
+                return true;
+            }
+
+            bool steal(uint32_t id, void*& out) {
+                for (uint32_t offset = 1; offset < active; ++offset) {
+                    if (pop_shared(*workers[(id + offset) % active], false, out)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            bool any_shared_work() {
+                for (uint32_t i = 0; i < active; ++i) {
+                    if (workers[i]->shared_size.load(std::memory_order_acquire) > 0) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            bool next_task(uint32_t id, void*& out) {
+                MarkWorker& self = *workers[id];
+
+                if (self.local.pop(out)) {
+                    return true;
+                }
+
+                return pop_shared(self, true, out) || steal(id, out);
+            }
+
+            void drain(uint32_t id) {
+                MarkWorker& self = *workers[id];
+
+                while (true) {
+                    void* current = nullptr;
+
+                    if (next_task(id, current)) {
+                        if (ObjectHeader* header = heap_mark_claim(current, true)) {
+                            __gc_scan_object(payload_of(header), header, push_visit, &self);
+                        }
+                        continue;
+                    }
+
+                    // 进入空闲状态。空闲的 worker 不会再产生新任务，
+                    // 所以当所有 worker 同时空闲时，标记就已经完成。
+                    idle.fetch_add(1, std::memory_order_acq_rel);
+                    while (true) {
+                        if (idle.load(std::memory_order_acquire) == active) {
+                            return;
+                        }
+
+                        if (any_shared_work()) {
+                            idle.fetch_sub(1, std::memory_order_acq_rel);
+                            break;
+                        }
+
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        };
+
+        MarkPool& pool() {
+            static MarkPool mark_pool;
+            return mark_pool;
+        }
+
+        // 增量标记在多个 slice 之间共享的 grey stack。
+        MarkStack grey_stack;
+
+        // 每处理这么多个对象才读一次时钟，避免计时本身成为开销。
+        constexpr uint32_t CLOCK_CHECK_INTERVAL = 64;
+
+        void mark_serial(const std::vector<void*>& seeds) {
+            MarkStack work_stack;
+            work_stack.items.assign(seeds.begin(), seeds.end());
+
+            void* current = nullptr;
+            while (work_stack.pop(current)) {
+                if (ObjectHeader* header = heap_mark_claim(current, false)) {
+                    __gc_scan_object(payload_of(header), header, push_grey, &work_stack);
+                }
+            }
+        }
+    }
+
+    void mark_from_seeds(const std::vector<void*>& seeds, uint32_t threads) {
+        if (threads <= 1) {
+            mark_serial(seeds);
+            return;
+        }
+
+        pool().run(seeds, threads);
+    }
+
+    void incremental_mark_start(const std::vector<void*>& seeds) {
+        grey_stack.release();
+        grey_stack.items.assign(seeds.begin(), seeds.end());
+    }
+
+    void incremental_mark_shade(void* obj) {
+        if (obj) {
+            grey_stack.push(obj);
+        }
+    }
+
+    bool incremental_mark_step(uint64_t budget_ns) {
+        const auto start = std::chrono::steady_clock::now();
+        uint32_t processed = 0;
+
+        while (!grey_stack.empty()) {
+            if (++processed % CLOCK_CHECK_INTERVAL == 0) {
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                if (static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) >= budget_ns) {
+                    return false;
+                }
+            }
+
+            void* current = nullptr;
+            if (!grey_stack.pop(current)) {
+                break;
+            }
+
+            if (ObjectHeader* header = heap_mark_claim(current, false)) {
+                __gc_scan_object(payload_of(header), header, push_grey, &grey_stack);
+            }
+        }
+
+        return true;
+    }
+
+    void incremental_mark_finish(const std::vector<void*>& roots, uint32_t threads) {
+        std::vector<void*> seeds;
+        grey_stack.take_all(seeds);
+        seeds.insert(seeds.end(), roots.begin(), roots.end());
+
+        mark_from_seeds(seeds, threads);
+    }
+
+    void incremental_mark_abort() {
+        grey_stack.release();
+    }
+}
@@ -0,0 +1,37 @@
+/*
+    SakuraE Runtime Library
+    mark.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_MARK_H
+#define SAKURAE_RUNTIME_MARK_H
+
+#include <cstdint>
+#include <vector>
+
+#include "gc.h"
+
+namespace sakuraE::runtime {
+    // 从 seeds 出发标记所有可达对象，mark 位写进 heap 的 side bitmap（见 heap_mark_claim）。
+    // mark stack 是连续的数组，出栈时经过一个小的预取 FIFO，提前把对象头拉进缓存。
+    // threads > 1 时启用并行标记：seeds 被均分给各个 GC worker，
+    // 每个 worker 拥有自己的 mark stack，空闲时从其他 worker 那里窃取任务。
+    void mark_from_seeds(const std::vector<void*>& seeds, uint32_t threads);
+
+    // 增量标记：灰色对象保存在一个跨 slice 存活的 grey stack 中，
+    // mutator 每次只推进一小段标记工作。
+    void incremental_mark_start(const std::vector<void*>& seeds);
+    // 把一个对象染灰（压入 grey stack），供 write barrier 使用。
+    void incremental_mark_shade(void* obj);
+    // 推进标记直到 grey stack 为空或超出 budget_ns，grey stack 为空时返回 true。
+    bool incremental_mark_step(uint64_t budget_ns);
+    // 结束本轮标记：重新扫描 roots，并把剩余的灰色对象一次性标完。
+    void incremental_mark_finish(const std::vector<void*>& roots, uint32_t threads);
+    // 放弃本轮标记，丢弃 grey stack。调用方负责清除已经写入的 mark。
+    void incremental_mark_abort();
+}
+
+#endif // !SAKURAE_RUNTIME_MARK_H
@@ -0,0 +1,65 @@
+/*
+    SakuraE Runtime Library
+    native_stack.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "native_stack.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+
+#include "heap.h"
+
+namespace sakuraE::runtime {
+    namespace {
+        // 从本函数的栈帧扫到栈底。调用方已经把 callee-saved 寄存器压进了更高地址的栈帧，
+        // 所以这里的扫描范围同时覆盖了寄存器里的指针。
+        __attribute__((noinline))
+        void scan_stack_words(std::vector<void*>& seeds) {
+            uintptr_t stack_bottom = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+            conservative_scan_stack(seeds, stack_bottom, native_stack_top());
+        }
+    }
+
+    // 扫描会读到 sanitizer 的栈 redzone，因此关闭 AddressSanitizer 插桩。
+    __attribute__((no_sanitize("address")))
+    void conservative_scan_stack(std::vector<void*>& seeds, uintptr_t stack_bottom, uintptr_t stack_top) {
+        for (uintptr_t addr = stack_bottom; addr + sizeof(void*) <= stack_top; addr += sizeof(void*)) {
+            void* word = *reinterpret_cast<void**>(addr);
+            if (word && heap_find(word)) {
+                seeds.push_back(word);
+            }
+        }
+    }
+
+    uintptr_t native_stack_top() {
+        static thread_local uintptr_t stack_top = 0;
+        if (stack_top) {
+            return stack_top;
+        }
+
+        pthread_attr_t attr;
+        void* stack_addr = nullptr;
+        size_t stack_size = 0;
+        if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+            fprintf(stderr, "[Runtime Error] Failed to query the native stack bounds.\n");
+            exit(1);
+        }
+        pthread_attr_getstack(&attr, &stack_addr, &stack_size);
+        pthread_attr_destroy(&attr);
+
+        stack_top = reinterpret_cast<uintptr_t>(stack_addr) + stack_size;
+        return stack_top;
+    }
+
+    __attribute__((noinline))
+    void conservative_collect_roots(std::vector<void*>& seeds) {
+        // 强制把所有 callee-saved 寄存器保存到本函数栈帧里，再由下一层函数统一扫描。
+        __builtin_unwind_init();
+        scan_stack_words(seeds);
+    }
+}
@@ -0,0 +1,27 @@
+/*
+    SakuraE Runtime Library
+    native_stack.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_NATIVE_STACK_H
+#define SAKURAE_RUNTIME_NATIVE_STACK_H
+
+#include <cstdint>
+#include <vector>
+
+namespace sakuraE::runtime {
+    // 当前线程原生栈的最高地址（栈向低地址增长），第一次调用时查询并缓存。
+    uintptr_t native_stack_top();
+
+    // 保守扫描：把寄存器和当前线程原生栈上每个能被堆索引解析成对象的字都当作 root。
+    // 指向对象内部的指针同样有效；误判的整数只会让对象多存活一轮。
+    void conservative_collect_roots(std::vector<void*>& seeds);
+
+    // 保守扫描另一个线程停下时的原生栈 [stack_bottom, stack_top)。
+    void conservative_scan_stack(std::vector<void*>& seeds, uintptr_t stack_bottom, uintptr_t stack_top);
+}
+
+#endif // !SAKURAE_RUNTIME_NATIVE_STACK_H
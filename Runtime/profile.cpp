@@ -0,0 +1,296 @@
+/*
+    SakuraE Runtime Library
+    profile.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "profile.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace sakuraE::runtime {
+    namespace {
+        constexpr size_t DEFAULT_PROFILE_RATE = 512 * 1024;
+
+        // 分配点描述符和类型描述符多半是 JIT 代码里的常量，模块卸载后就失效了，
+        // 所以采样时把内容拷贝出来作为 key：(函数名, 行, 列, 类型名)。
+        using ProfileKey = std::tuple<std::string, uint32_t, uint32_t, std::string>;
+
+        // 一个 (分配点, 类型) 上的估计分配量，已经按采样概率放大。
+        struct ProfileSample {
+            double objects = 0;
+            double bytes = 0;
+        };
+
+        struct ProfileState {
+            std::string output;
+            size_t rate = DEFAULT_PROFILE_RATE;
+
+            // 距离下一次采样还要分配的字节数。
+            int64_t bytes_until_sample = 0;
+            uint64_t rng = 0x9e3779b97f4a7c15ull;
+
+            std::map<ProfileKey, ProfileSample> samples;
+        };
+
+        const char* default_output() {
+            const char* value = std::getenv("SAKURAE_GC_PROFILE");
+            return value ? value : "";
+        }
+
+        size_t default_rate() {
+            const char* value = std::getenv("SAKURAE_GC_PROFILE_RATE");
+            if (!value) {
+                return DEFAULT_PROFILE_RATE;
+            }
+            return static_cast<size_t>(std::strtoull(value, nullptr, 10));
+        }
+
+        ProfileState* create_profile();
+
+        // 和统计状态一样刻意不析构，退出时的输出发生在静态析构阶段。
+        ProfileState& profile() {
+            static auto* profile_state = create_profile();
+            return *profile_state;
+        }
+
+        // xorshift64*，只用来打散采样点，不需要密码学强度。
+        uint64_t next_random(ProfileState& state) {
+            state.rng ^= state.rng >> 12;
+            state.rng ^= state.rng << 25;
+            state.rng ^= state.rng >> 27;
+            return state.rng * 0x2545f4914f6cdd1dull;
+        }
+
+        // 采样间隔服从均值为 rate 的指数分布，等价于每个字节以 1/rate 的概率被选中，
+        // 这样采样点不会和程序里固定步长的分配模式对齐。
+        int64_t next_sample_interval(ProfileState& state) {
+            double u = static_cast<double>((next_random(state) >> 11) + 1) * 0x1.0p-53;
+            return static_cast<int64_t>(-std::log(u) * static_cast<double>(state.rate)) + 1;
+        }
+
+        // 第一个采样点同样随机选取，否则第一次分配总会被采到并按 rate 放大。
+        void reset_sample_interval(ProfileState& state) {
+            state.bytes_until_sample = state.rate > 0 ? next_sample_interval(state) : 0;
+        }
+
+        ProfileState* create_profile() {
+            auto* state = new ProfileState { .output = default_output(), .rate = default_rate() };
+            reset_sample_interval(*state);
+            return state;
+        }
+
+        // 手写的 protobuf 编码器，只实现 profile.proto 用到的 varint 与 length-delimited 两种 wire type。
+        class ProtoWriter {
+        public:
+            void varint(uint64_t value) {
+                while (value >= 0x80) {
+                    buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                    value >>= 7;
+                }
+                buffer.push_back(static_cast<char>(value));
+            }
+
+            void uint_field(uint32_t field, uint64_t value) {
+                varint(uint64_t(field) << 3);
+                varint(value);
+            }
+
+            void bytes_field(uint32_t field, const std::string& value) {
+                varint((uint64_t(field) << 3) | 2);
+                varint(value.size());
+                buffer += value;
+            }
+
+            void message_field(uint32_t field, const ProtoWriter& message) {
+                bytes_field(field, message.buffer);
+            }
+
+            void packed_field(uint32_t field, const std::vector<uint64_t>& values) {
+                ProtoWriter packed;
+                for (uint64_t value : values) {
+                    packed.varint(value);
+                }
+                bytes_field(field, packed.buffer);
+            }
+
+            const std::string& data() const {
+                return buffer;
+            }
+
+        private:
+            std::string buffer;
+        };
+
+        // pprof 里所有字符串都是 string_table 的下标，下标 0 必须是空串。
+        class StringTable {
+        public:
+            StringTable() {
+                intern("");
+            }
+
+            uint64_t intern(const std::string& value) {
+                auto [it, inserted] = index.emplace(value, strings.size());
+                if (inserted) {
+                    strings.push_back(value);
+                }
+                return it->second;
+            }
+
+            const std::vector<std::string>& all() const {
+                return strings;
+            }
+
+        private:
+            std::map<std::string, uint64_t> index;
+            std::vector<std::string> strings;
+        };
+
+        ProtoWriter value_type(StringTable& strings, const char* type, const char* unit) {
+            ProtoWriter message;
+            message.uint_field(1, strings.intern(type));
+            message.uint_field(2, strings.intern(unit));
+            return message;
+        }
+
+        std::string encode_profile(const ProfileState& state) {
+            StringTable strings;
+            ProtoWriter out;
+
+            out.message_field(1, value_type(strings, "alloc_objects", "count"));
+            out.message_field(1, value_type(strings, "alloc_space", "bytes"));
+
+            // 同名函数共用一个 Function，同一 (函数, 行, 列) 共用一个 Location；id 从 1 开始。
+            std::map<std::string, uint64_t> function_ids;
+            std::map<std::tuple<std::string, uint32_t, uint32_t>, uint64_t> location_ids;
+            ProtoWriter functions;
+            ProtoWriter locations;
+
+            uint64_t label_key = strings.intern("type");
+
+            for (const auto& [key, sample] : state.samples) {
+                const auto& [function, line, column, type] = key;
+
+                auto [fn, fn_inserted] = function_ids.emplace(function, function_ids.size() + 1);
+                if (fn_inserted) {
+                    ProtoWriter message;
+                    message.uint_field(1, fn->second);
+                    message.uint_field(2, strings.intern(function));
+                    message.uint_field(3, strings.intern(function));
+                    functions.message_field(5, message);
+                }
+
+                auto [loc, loc_inserted] = location_ids.emplace(std::make_tuple(function, line, column), location_ids.size() + 1);
+                if (loc_inserted) {
+                    ProtoWriter line_message;
+                    line_message.uint_field(1, fn->second);
+                    line_message.uint_field(2, line);
+                    line_message.uint_field(3, column);
+
+                    ProtoWriter message;
+                    message.uint_field(1, loc->second);
+                    message.message_field(4, line_message);
+                    locations.message_field(4, message);
+                }
+
+                ProtoWriter label;
+                label.uint_field(1, label_key);
+                label.uint_field(2, strings.intern(type));
+
+                ProtoWriter message;
+                message.packed_field(1, { loc->second });
+                message.packed_field(2, {
+                    static_cast<uint64_t>(std::llround(sample.objects)),
+                    static_cast<uint64_t>(std::llround(sample.bytes))
+                });
+                message.message_field(3, label);
+                out.message_field(2, message);
+            }
+
+            // 字段按编号写出：sample(2) 已经写完，接下来是 location(4) 和 function(5)。
+            std::string result = out.data() + locations.data() + functions.data();
+
+            // period_type 引用的字符串要在写出字符串表之前登记。
+            ProtoWriter period_type = value_type(strings, "space", "bytes");
+
+            ProtoWriter tail;
+            for (const std::string& value : strings.all()) {
+                tail.bytes_field(6, value);
+            }
+            auto now = std::chrono::system_clock::now().time_since_epoch();
+            tail.uint_field(9, std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+            tail.message_field(11, period_type);
+            tail.uint_field(12, state.rate);
+            return result + tail.data();
+        }
+    }
+
+    void gc_set_profile_output(const char* path) {
+        profile().output = path ? path : "";
+    }
+
+    void gc_set_profile_rate(size_t bytes) {
+        ProfileState& state = profile();
+        state.rate = bytes;
+        reset_sample_interval(state);
+    }
+
+    bool profile_enabled() {
+        return !profile().output.empty();
+    }
+
+    void profile_record_alloc(const GCAllocSite* site, const GCTypeInfo* ty, size_t bytes) {
+        ProfileState& state = profile();
+
+        double weight = 1.0;
+        if (state.rate > 0) {
+            state.bytes_until_sample -= static_cast<int64_t>(bytes);
+            if (state.bytes_until_sample > 0) {
+                return;
+            }
+            while (state.bytes_until_sample <= 0) {
+                state.bytes_until_sample += next_sample_interval(state);
+            }
+
+            // 大小为 bytes 的对象被采到的概率是 1 - e^(-bytes/rate)，按它的倒数放大得到无偏估计。
+            weight = 1.0 / (1.0 - std::exp(-static_cast<double>(bytes) / static_cast<double>(state.rate)));
+        }
+
+        ProfileKey key {
+            site && site->function ? site->function : "<unknown>",
+            site ? site->line : 0,
+            site ? site->column : 0,
+            ty && ty->name ? ty->name : "atomic"
+        };
+        ProfileSample& sample = state.samples[key];
+        sample.objects += weight;
+        sample.bytes += weight * static_cast<double>(bytes);
+    }
+
+    void profile_report_at_exit() {
+        const ProfileState& state = profile();
+        if (state.output.empty()) {
+            return;
+        }
+
+        FILE* out = std::fopen(state.output.c_str(), "wb");
+        if (!out) {
+            fprintf(stderr, "[Runtime Error] Failed to open GC profile output: %s\n", state.output.c_str());
+            return;
+        }
+
+        std::string data = encode_profile(state);
+        std::fwrite(data.data(), 1, data.size(), out);
+        std::fclose(out);
+    }
+}
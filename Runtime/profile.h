@@ -0,0 +1,37 @@
+/*
+    SakuraE Runtime Library
+    profile.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_PROFILE_H
+#define SAKURAE_RUNTIME_PROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gc.h"
+
+namespace sakuraE::runtime {
+    // 采样式堆 profiler：平均每分配 rate 字节采样一次，按 (分配点, 类型) 汇总，
+    // 进程退出时写成 pprof 格式（未压缩的 profile.proto），可以直接交给 `go tool pprof` 查看。
+    // 默认值来自环境变量 SAKURAE_GC_PROFILE（输出路径）和 SAKURAE_GC_PROFILE_RATE（字节数）。
+
+    // 设置输出路径，空字符串表示关闭。
+    void gc_set_profile_output(const char* path);
+    // 平均采样间隔（字节），0 表示记录每一次分配。
+    void gc_set_profile_rate(size_t bytes);
+
+    // 开启 profiler 时分配缓冲区被关闭，每次分配都经过运行时慢路径。
+    bool profile_enabled();
+
+    // 由 gc_alloc 的慢路径在持有 GC 锁时调用，bytes 包含对象头。
+    void profile_record_alloc(const GCAllocSite* site, const GCTypeInfo* ty, size_t bytes);
+
+    // 按设置写出一次 profile，GCCleaner 在释放堆之前调用。
+    void profile_report_at_exit();
+}
+
+#endif // !SAKURAE_RUNTIME_PROFILE_H
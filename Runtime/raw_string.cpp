@@ -8,28 +8,43 @@
 #include "raw_string.h"
 #include "gc.h"
 #include "alloc.h"
+#include "string_kernels.h"
 
 using namespace sakuraE::runtime;
 
-extern "C" char* create_string(const char* literal) {
+extern "C" char* __create_string(const char* literal, const GCAllocSite* site) {
     if (!literal) return nullptr;
 
-    size_t len = strlen(literal);
-    char* str = (char*)__gc_alloc(len + 1, __gc_get_atomic_type());
+    // 字面量是普通 C 字符串，只有这里需要扫描长度；结尾的 NUL 一起拷贝。
+    size_t size = string_kernels->length(literal) + 1;
+    char* str = (char*)__gc_alloc_uninit(size, __gc_get_atomic_type(), site);
 
-    strcpy(str, literal);
+    memcpy(str, literal, size);
     return str;
 }
 
+extern "C" char* create_string(const char* literal) {
+    return __create_string(literal, nullptr);
+}
+
 extern "C" void free_string(char* str) {
     (void)str;
 }
 
-extern "C" char* concat_string(const char* s1, const char* s2) {
-    if (!s1) s1 = "";
-    if (!s2) s2 = "";
+extern "C" char* __string_make_mutable(char* str, const GCAllocSite* site) {
+    if (!str || !(reinterpret_cast<ObjectHeader*>(str)[-1].flags & Immortal)) return str;
+
+    // 字面量不在 GC 堆上，分配期间不会被移动，不需要根住。
+    size_t size = string_length(str) + 1;
+    char* copy = (char*)__gc_alloc_uninit(size, __gc_get_atomic_type(), site);
 
-    // `concat_string` 在真正拼接前可能先触发新的 GC 分配。
+    memcpy(copy, str, size);
+    return copy;
+}
+
+// 拼接长度已知的两段字符。长度在分配之前算好，之后的搬迁不会改变它。
+static char* concat_chars(const char* s1, size_t len1, const char* s2, size_t len2, const GCAllocSite* site) {
+    // `__concat_string` 在真正拼接前可能先触发新的 GC 分配。
     // 因此先把两个入参临时压入根栈，避免它们在本次调用中途被误回收。
     void* root1 = const_cast<char*>(s1);
     void* root2 = const_cast<char*>(s2);
@@ -38,19 +53,201 @@ extern "C" char* concat_string(const char* s1, const char* s2) {
     __gc_register(&root1);
     __gc_register(&root2);
 
-    // 之后统一从被根住的局部变量中读取安全入参。
-    const char* safe_s1 = static_cast<const char*>(root1);
-    const char* safe_s2 = static_cast<const char*>(root2);
+    // 结果马上会被写满，不需要清零。
+    char* result = (char*)__gc_alloc_uninit(len1 + len2 + 1, __gc_get_atomic_type(), site);
+    if (!result) exit(1);
 
-    size_t len1 = strlen(safe_s1);
-    size_t len2 = strlen(safe_s2);
+    // 开启压缩时，这次分配触发的回收可能搬走入参，所以分配之后再从被根住的局部变量中读取。
+    if (len1) memcpy(result, root1, len1);
+    if (len2) memcpy(result + len1, root2, len2);
+    result[len1 + len2] = '\0';
+    // 拼接完成后，释放本次调用临时压入的根。
+    __gc_leave_scope();
+    return result;
+}
+
+// codegen 生成的调用只会传入字符串对象，长度直接从 header 读出；空指针按空串处理。
+extern "C" char* __concat_string(const char* s1, const char* s2, const GCAllocSite* site) {
+    return concat_chars(s1, s1 ? string_length(s1) : 0, s2, s2 ? string_length(s2) : 0, site);
+}
+
+extern "C" char* __concat_n(uint32_t count, char** parts, const GCAllocSite* site) {
+    size_t length = 0;
+    for (uint32_t i = 0; i < count; i ++) {
+        if (parts[i]) length += string_length(parts[i]);
+    }
 
-    char* result = (char*)__gc_alloc(len1 + len2 + 1, __gc_get_atomic_type());
+    __gc_enter_scope();
+    for (uint32_t i = 0; i < count; i ++) {
+        __gc_register(reinterpret_cast<void**>(&parts[i]));
+    }
+
+    char* result = (char*)__gc_alloc_uninit(length + 1, __gc_get_atomic_type(), site);
     if (!result) exit(1);
 
-    strcpy(result, safe_s1);
-    strcat(result, safe_s2);
-    // 拼接完成后，释放本次调用临时压入的根。
+    // 长度只取决于 header，搬迁不会改变它；片段地址要在分配之后从 parts 重新读取。
+    char* cursor = result;
+    for (uint32_t i = 0; i < count; i ++) {
+        if (!parts[i]) continue;
+
+        size_t part_length = string_length(parts[i]);
+        if (part_length) memcpy(cursor, parts[i], part_length);
+        cursor += part_length;
+    }
+    *cursor = '\0';
+    __gc_leave_scope();
+    return result;
+}
+
+// 原生代码可能传入普通 C 字符串，所以这里仍然扫描长度。
+extern "C" char* concat_string(const char* s1, const char* s2) {
+    return concat_chars(s1, s1 ? string_kernels->length(s1) : 0, s2, s2 ? string_kernels->length(s2) : 0, nullptr);
+}
+
+static size_t length_or_zero(const char* str) {
+    return str ? string_length(str) : 0;
+}
+
+extern "C" int64_t __string_length(const char* str) {
+    return static_cast<int64_t>(length_or_zero(str));
+}
+
+extern "C" bool __string_equal(const char* lhs, const char* rhs) {
+    if (lhs == rhs) return true;
+
+    size_t length = length_or_zero(lhs);
+    return length == length_or_zero(rhs) && string_kernels->equal(lhs, rhs, length);
+}
+
+extern "C" int32_t __string_compare(const char* lhs, const char* rhs) {
+    return string_kernels->compare(lhs, length_or_zero(lhs), rhs, length_or_zero(rhs));
+}
+
+extern "C" int64_t __string_find(const char* str, const char* needle) {
+    // 空指针也按空串处理，空的 needle 总是匹配开头。
+    if (!length_or_zero(needle)) return 0;
+
+    const char* found = string_kernels->find(str, length_or_zero(str), needle, length_or_zero(needle));
+    return found ? found - str : -1;
+}
+
+extern "C" int64_t __string_find_char(const char* str, char ch) {
+    const char* found = string_kernels->find_char(str, length_or_zero(str), ch);
+    return found ? found - str : -1;
+}
+
+extern "C" uint64_t __string_hash(const char* str) {
+    return string_kernels->hash(str, length_or_zero(str));
+}
+
+// 按 convert 生成一个长度相同的新字符串。分配期间根住 str，分配之后再从根里读取。
+static char* map_string(const char* str, void (*convert)(char*, const char*, size_t), const GCAllocSite* site) {
+    size_t length = length_or_zero(str);
+    void* root = const_cast<char*>(str);
+
+    __gc_enter_scope();
+    __gc_register(&root);
+    char* result = (char*)__gc_alloc_uninit(length + 1, __gc_get_atomic_type(), site);
+    if (!result) exit(1);
+
+    convert(result, static_cast<const char*>(root), length);
+    result[length] = '\0';
+    __gc_leave_scope();
+    return result;
+}
+
+extern "C" char* __string_to_lower(const char* str, const GCAllocSite* site) {
+    return map_string(str, string_kernels->to_lower, site);
+}
+
+extern "C" char* __string_to_upper(const char* str, const GCAllocSite* site) {
+    return map_string(str, string_kernels->to_upper, site);
+}
+
+
+// builder 的最小容量，避免刚开始追加短串时频繁扩容。
+static constexpr size_t STRING_BUILDER_MIN_CAPACITY = 32;
+
+static StringBuilderHeader* builder_header(const char* builder) {
+    return reinterpret_cast<StringBuilderHeader*>(const_cast<char*>(builder));
+}
+
+static char* builder_chars(const char* builder) {
+    return const_cast<char*>(builder) + sizeof(StringBuilderHeader);
+}
+
+// 分配一个容量至少为 capacity 的 builder，并把 chars 的前 length 个字符拷进去。
+// chars 所在的对象由调用方根住，这里通过 root 重新读取，压缩搬走它之后也能拿到新地址。
+static char* builder_alloc(void** root, size_t offset, size_t length, size_t capacity, const GCAllocSite* site) {
+    if (capacity > GC_MAX_OBJECT_SIZE - sizeof(StringBuilderHeader)) {
+        fprintf(stderr, "[Runtime Error] String of %zu bytes exceeds the maximum object size of %zu bytes\n", capacity, GC_MAX_OBJECT_SIZE);
+        exit(1);
+    }
+
+    char* builder = (char*)__gc_alloc_uninit(sizeof(StringBuilderHeader) + capacity, __gc_get_atomic_type(), site);
+    if (!builder) exit(1);
+
+    builder_header(builder)->length = length;
+    if (length) memcpy(builder_chars(builder), static_cast<char*>(*root) + offset, length);
+    return builder;
+}
+
+static size_t builder_grow(size_t capacity, size_t required) {
+    size_t grown = capacity * 2;
+    if (grown < STRING_BUILDER_MIN_CAPACITY) grown = STRING_BUILDER_MIN_CAPACITY;
+    if (grown > GC_MAX_OBJECT_SIZE - sizeof(StringBuilderHeader)) grown = GC_MAX_OBJECT_SIZE - sizeof(StringBuilderHeader);
+    return grown < required ? required : grown;
+}
+
+extern "C" char* __string_builder_new(const char* initial, const GCAllocSite* site) {
+    size_t length = initial ? string_length(initial) : 0;
+    void* root = const_cast<char*>(initial);
+
+    __gc_enter_scope();
+    __gc_register(&root);
+    char* builder = builder_alloc(&root, 0, length, builder_grow(length, length), site);
+    __gc_leave_scope();
+    return builder;
+}
+
+extern "C" char* __string_builder_append(char* builder, const char* str, const GCAllocSite* site) {
+    size_t add = str ? string_length(str) : 0;
+    if (!add) return builder;
+
+    size_t length = builder_header(builder)->length;
+    if (length + add <= string_builder_capacity(builder)) {
+        // 快路径：原地追加，不分配。
+        memcpy(builder_chars(builder) + length, str, add);
+        builder_header(builder)->length = length + add;
+        return builder;
+    }
+
+    // 扩容会分配，期间旧 builder 和 str 都可能被搬走，所以先根住，分配之后再从根里读取。
+    void* root_builder = builder;
+    void* root_str = const_cast<char*>(str);
+
+    __gc_enter_scope();
+    __gc_register(&root_builder);
+    __gc_register(&root_str);
+    char* grown = builder_alloc(&root_builder, sizeof(StringBuilderHeader), length,
+                                builder_grow(string_builder_capacity(builder), length + add), site);
+    memcpy(builder_chars(grown) + length, root_str, add);
+    builder_header(grown)->length = length + add;
+    __gc_leave_scope();
+    return grown;
+}
+
+extern "C" char* __string_builder_finish(const char* builder, const GCAllocSite* site) {
+    size_t length = builder_header(builder)->length;
+    void* root = const_cast<char*>(builder);
+
+    __gc_enter_scope();
+    __gc_register(&root);
+    char* result = (char*)__gc_alloc_uninit(length + 1, __gc_get_atomic_type(), site);
+    if (!result) exit(1);
+
+    if (length) memcpy(result, builder_chars(static_cast<char*>(root)), length);
+    result[length] = '\0';
     __gc_leave_scope();
     return result;
 }
@@ -13,6 +13,14 @@
 #include <cstring>
 #include <cstdio>
 #include "alloc.h"
+#include "gc.h"
+
+// 字符串对象是一个 atomic GC 对象：payload 是 length 个字符再加一个结尾的 NUL。
+// 长度不另外存放，就是 header 里的 obj_size - 1，取长度不需要扫描；codegen 的 == / != 也直接读它。
+// 结尾的 NUL 让字符串仍然可以当作 C 字符串交给 printf 这类函数。
+inline size_t string_length(const char* str) {
+    return reinterpret_cast<const sakuraE::runtime::ObjectHeader*>(str)[-1].obj_size - 1;
+}
 
 extern "C" char* create_string(const char* literal);
 
@@ -20,4 +28,59 @@ extern "C" void free_string(char* str);
 
 extern "C" char* concat_string(const char* s1, const char* s2);
 
+// 与 create_string / concat_string 相同，另外带上分配点描述符，codegen 生成的调用使用这两个版本。
+// __concat_string 的参数必须是字符串对象（或空指针），长度从 header 读取；concat_string 也接受普通 C 字符串。
+extern "C" char* __create_string(const char* literal, const sakuraE::runtime::GCAllocSite* site);
+
+extern "C" char* __concat_string(const char* s1, const char* s2, const sakuraE::runtime::GCAllocSite* site);
+
+// 字符串字面量是只读的常量对象（header 的 flags 带 Immortal），按下标写入之前先调用它得到堆上的副本。
+// 堆上的字符串原样返回。
+extern "C" char* __string_make_mutable(char* str, const sakuraE::runtime::GCAllocSite* site);
+
+// 字符串内核的入口，实现见 string_kernels.h，按启动时选定的 SIMD 级别执行。
+// 参数必须是字符串对象或空指针（按空串处理），长度都从 header 读取。这几个函数不分配，不会触发回收。
+extern "C" int64_t __string_length(const char* str);
+
+extern "C" bool __string_equal(const char* lhs, const char* rhs);
+
+// 按无符号字节的字典序比较，返回 -1 / 0 / 1。
+extern "C" int32_t __string_compare(const char* lhs, const char* rhs);
+
+// 第一次出现的下标，找不到返回 -1；空的 needle 返回 0。
+extern "C" int64_t __string_find(const char* str, const char* needle);
+
+extern "C" int64_t __string_find_char(const char* str, char ch);
+
+extern "C" uint64_t __string_hash(const char* str);
+
+// 返回一个新的字符串，只转换 ASCII 字母的大小写。
+extern "C" char* __string_to_lower(const char* str, const sakuraE::runtime::GCAllocSite* site);
+
+extern "C" char* __string_to_upper(const char* str, const sakuraE::runtime::GCAllocSite* site);
+
+// 一次拼接 count 段字符串：先算出总长度，只分配一次，再逐段拷贝。codegen 把连续的字符串 + 合并成一次调用。
+// parts 里每一项都必须是字符串对象或空指针（按空串处理）。分配期间各项被注册为根，压缩搬走片段后会就地更新 parts。
+extern "C" char* __concat_n(uint32_t count, char** parts, const sakuraE::runtime::GCAllocSite* site);
+
+// string builder 同样是一个 atomic GC 对象：payload 开头是 8 字节的已用长度，后面是字符缓冲区，容量为 obj_size - 8。
+// codegen 把循环里只做追加的字符串变量改写成 builder，循环结束时再一次性生成字符串对象，
+// 这样构造 N 个字符只需要摊还 O(N) 的拷贝，而不是每次拼接都复制一遍前缀。
+struct StringBuilderHeader {
+    uint64_t length;
+};
+
+inline size_t string_builder_capacity(const char* builder) {
+    return reinterpret_cast<const sakuraE::runtime::ObjectHeader*>(builder)[-1].obj_size - sizeof(StringBuilderHeader);
+}
+
+// 以 initial 的内容新建一个 builder；initial 必须是字符串对象或空指针。
+extern "C" char* __string_builder_new(const char* initial, const sakuraE::runtime::GCAllocSite* site);
+
+// 把 str 追加到 builder 末尾。容量不够时按倍数扩容并返回新的 builder，调用方必须用返回值替换原来的引用。
+extern "C" char* __string_builder_append(char* builder, const char* str, const sakuraE::runtime::GCAllocSite* site);
+
+// 按 builder 当前的内容生成一个大小恰好的字符串对象，builder 本身保持不变。
+extern "C" char* __string_builder_finish(const char* builder, const sakuraE::runtime::GCAllocSite* site);
+
 #endif
\ No newline at end of file
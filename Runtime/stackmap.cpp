@@ -0,0 +1,292 @@
+/*
+    SakuraE Runtime Library
+    stackmap.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "stackmap.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "native_stack.h"
+
+namespace sakuraE::runtime {
+    namespace {
+        // StackMap v3 里的 location 类型，见 LLVM 文档 "Stack maps and patch points"。
+        enum class LocationKind: uint8_t {
+            Register = 1,
+            Direct = 2,
+            Indirect = 3,
+            Constant = 4,
+            ConstantIndex = 5
+        };
+
+        // x86-64 的 DWARF 寄存器编号。
+        constexpr uint16_t DWARF_RBP = 6;
+        constexpr uint16_t DWARF_RSP = 7;
+
+        // statepoint 记录的前三个 location 固定为常量：calling convention、flags、deopt 参数个数。
+        constexpr uint16_t STATEPOINT_HEADER_LOCATIONS = 3;
+
+        // 一个 root 槽位：相对调用点 SP / 帧指针的偏移。
+        // Direct 表示槽位就在 base + offset；Indirect 表示 base + offset 处存着槽位地址。
+        struct StackSlot {
+            LocationKind kind;
+            uint16_t base_reg;
+            int32_t offset;
+        };
+
+        struct CallSite {
+            std::vector<StackSlot> slots;
+        };
+
+        // 以返回地址为键：回溯到的某个帧的返回地址等于它时，说明调用方停在这个 statepoint 上。
+        std::unordered_map<uintptr_t, CallSite> call_sites;
+        // 所有已登记调用点的地址范围，回溯时先用它快速排除宿主代码的返回地址。
+        uintptr_t code_begin = UINTPTR_MAX;
+        uintptr_t code_end = 0;
+
+        [[noreturn]] void malformed_stackmap(const char* reason) {
+            fprintf(stderr, "[Runtime Error] Malformed stack map section: %s\n", reason);
+            exit(1);
+        }
+
+        class StackMapReader {
+        public:
+            StackMapReader(const uint8_t* section, size_t section_size): data(section), size(section_size) {}
+
+            template<typename T>
+            T read() {
+                if (cursor + sizeof(T) > size) {
+                    malformed_stackmap("unexpected end of section");
+                }
+
+                T value;
+                std::memcpy(&value, data + cursor, sizeof(T));
+                cursor += sizeof(T);
+                return value;
+            }
+
+            void skip(size_t bytes) {
+                if (cursor + bytes > size) {
+                    malformed_stackmap("unexpected end of section");
+                }
+                cursor += bytes;
+            }
+
+            void align8() {
+                skip((8 - cursor % 8) % 8);
+            }
+
+        private:
+            const uint8_t* data;
+            size_t size;
+            size_t cursor = 0;
+        };
+
+        struct StackMapLocation {
+            LocationKind kind;
+            uint16_t reg;
+            int32_t offset;
+        };
+
+        StackMapLocation read_location(StackMapReader& reader) {
+            StackMapLocation location;
+            location.kind = static_cast<LocationKind>(reader.read<uint8_t>());
+            reader.skip(1);
+            reader.read<uint16_t>(); // location size
+            location.reg = reader.read<uint16_t>();
+            reader.skip(2);
+            location.offset = reader.read<int32_t>();
+            return location;
+        }
+
+        CallSite parse_call_site(const std::vector<StackMapLocation>& locations) {
+            CallSite site;
+            if (locations.size() < STATEPOINT_HEADER_LOCATIONS) {
+                return site;
+            }
+
+            // codegen 只把 root 槽位放进 deopt 参数，gc-live 部分为空。
+            const StackMapLocation& deopt_count = locations[STATEPOINT_HEADER_LOCATIONS - 1];
+            if (deopt_count.kind != LocationKind::Constant) {
+                malformed_stackmap("statepoint record without a deopt argument count");
+            }
+
+            size_t end = std::min<size_t>(locations.size(), STATEPOINT_HEADER_LOCATIONS + static_cast<uint32_t>(deopt_count.offset));
+            for (size_t i = STATEPOINT_HEADER_LOCATIONS; i < end; ++i) {
+                const StackMapLocation& location = locations[i];
+
+                switch (location.kind) {
+                    case LocationKind::Direct:
+                    case LocationKind::Indirect:
+                        if (location.reg != DWARF_RSP && location.reg != DWARF_RBP) {
+                            fprintf(stderr, "[Runtime Error] Unsupported stack map base register: %u\n", location.reg);
+                            exit(1);
+                        }
+                        site.slots.push_back({location.kind, location.reg, location.offset});
+                        break;
+                    case LocationKind::Constant:
+                    case LocationKind::ConstantIndex:
+                        break;
+                    case LocationKind::Register:
+                    default:
+                        // root 都是 alloca 槽位，不会出现在寄存器里；出现了说明 codegen 与运行时不一致。
+                        malformed_stackmap("root slot lives in a register");
+                }
+            }
+
+            return site;
+        }
+    }
+
+    extern "C" void __gc_register_stackmap(const uint8_t* section, size_t size) {
+        if (!section || size == 0) {
+            return;
+        }
+
+#if !defined(__x86_64__)
+        fprintf(stderr, "[Runtime Error] Statepoint stack maps are only supported on x86-64.\n");
+        exit(1);
+#endif
+
+        StackMapReader reader(section, size);
+        if (reader.read<uint8_t>() != 3) {
+            malformed_stackmap("unsupported version");
+        }
+        reader.skip(3);
+
+        uint32_t function_count = reader.read<uint32_t>();
+        uint32_t constant_count = reader.read<uint32_t>();
+        uint32_t record_count = reader.read<uint32_t>();
+
+        struct FunctionRecord {
+            uint64_t address;
+            uint64_t record_count;
+        };
+        std::vector<FunctionRecord> functions(function_count);
+        for (auto& function : functions) {
+            function.address = reader.read<uint64_t>();
+            reader.read<uint64_t>(); // stack size
+            function.record_count = reader.read<uint64_t>();
+        }
+
+        reader.skip(static_cast<size_t>(constant_count) * sizeof(uint64_t));
+
+        size_t function_index = 0;
+        uint64_t records_left = function_count ? functions[0].record_count : 0;
+        std::vector<StackMapLocation> locations;
+
+        for (uint32_t i = 0; i < record_count; ++i) {
+            while (records_left == 0) {
+                if (++function_index >= functions.size()) {
+                    malformed_stackmap("more records than functions describe");
+                }
+                records_left = functions[function_index].record_count;
+            }
+            records_left--;
+
+            reader.read<uint64_t>(); // patch point id
+            uint32_t instruction_offset = reader.read<uint32_t>();
+            reader.skip(2);
+            uint16_t location_count = reader.read<uint16_t>();
+
+            locations.clear();
+            for (uint16_t j = 0; j < location_count; ++j) {
+                locations.push_back(read_location(reader));
+            }
+
+            reader.align8();
+            reader.skip(2);
+            uint16_t live_out_count = reader.read<uint16_t>();
+            reader.skip(static_cast<size_t>(live_out_count) * 4);
+            reader.align8();
+
+            CallSite site = parse_call_site(locations);
+            if (site.slots.empty()) {
+                continue;
+            }
+
+            uintptr_t return_address = functions[function_index].address + instruction_offset;
+            code_begin = std::min(code_begin, return_address);
+            code_end = std::max(code_end, return_address + 1);
+            call_sites[return_address] = std::move(site);
+        }
+    }
+
+    bool stackmap_has_call_sites() {
+        return !call_sites.empty();
+    }
+
+    // 沿帧指针链回溯 [frame_pointer, stack_top)：生成代码都带 "frame-pointer"="all"，运行时也保留帧指针，
+    // 因此每个帧的 [rbp] 是调用方的 RBP，[rbp + 8] 是调用方压入的返回地址。
+    // 返回地址命中 statepoint 调用点时：call 指令执行时的 SP 是 rbp + 16，
+    // 以 RBP 为基址的槽位则相对调用方自己的 RBP，也就是 [rbp]。
+    // 链走出生成代码之后可能经过不保留帧指针的宿主代码，读到的值不再递增或越出栈范围时停下。
+    // 回溯会读到 sanitizer 的栈 redzone，因此关闭 AddressSanitizer 插桩。
+    __attribute__((no_sanitize("address")))
+    void stackmap_scan_stack(std::vector<void*>& seeds, uintptr_t frame_pointer, uintptr_t stack_top) {
+        if (call_sites.empty()) {
+            return;
+        }
+
+        uintptr_t stack_bottom = frame_pointer;
+        auto on_stack = [&](uintptr_t addr) {
+            return addr >= stack_bottom && addr + sizeof(uintptr_t) <= stack_top;
+        };
+
+        uintptr_t fp = frame_pointer;
+        while (fp % sizeof(uintptr_t) == 0 && on_stack(fp) && on_stack(fp + sizeof(uintptr_t))) {
+            uintptr_t caller_fp = *reinterpret_cast<uintptr_t*>(fp);
+            uintptr_t return_address = *reinterpret_cast<uintptr_t*>(fp + sizeof(uintptr_t));
+
+            auto it = return_address >= code_begin && return_address < code_end ? call_sites.find(return_address) : call_sites.end();
+            if (it != call_sites.end()) {
+                uintptr_t call_sp = fp + 2 * sizeof(uintptr_t);
+
+                for (const StackSlot& slot : it->second.slots) {
+                    uintptr_t base = slot.base_reg == DWARF_RSP ? call_sp : caller_fp;
+                    uintptr_t slot_addr = base + static_cast<intptr_t>(slot.offset);
+
+                    if (slot.kind == LocationKind::Indirect) {
+                        if (!on_stack(slot_addr)) {
+                            continue;
+                        }
+                        slot_addr = *reinterpret_cast<uintptr_t*>(slot_addr);
+                    }
+
+                    if (!on_stack(slot_addr)) {
+                        continue;
+                    }
+
+                    void* value = *reinterpret_cast<void**>(slot_addr);
+                    if (value) {
+                        seeds.push_back(value);
+                    }
+                }
+            }
+
+            if (caller_fp <= fp) {
+                break;
+            }
+            fp = caller_fp;
+        }
+    }
+
+    // 从本函数的帧指针开始回溯到栈底。
+    __attribute__((noinline))
+    void stackmap_collect_roots(std::vector<void*>& seeds) {
+        if (call_sites.empty()) {
+            return;
+        }
+
+        uintptr_t frame_pointer = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        stackmap_scan_stack(seeds, frame_pointer, native_stack_top());
+    }
+}
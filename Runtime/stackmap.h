@@ -0,0 +1,33 @@
+/*
+    SakuraE Runtime Library
+    stackmap.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_STACKMAP_H
+#define SAKURAE_RUNTIME_STACKMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sakuraE::runtime {
+    // JIT 完成重定位之后调用，登记一个 .llvm_stackmaps 段（LLVM StackMap v3 格式）。
+    // 段内容在登记时就被解析成按返回地址索引的表，调用方不需要保留它。
+    extern "C" void __gc_register_stackmap(const uint8_t* section, size_t size);
+
+    // 是否登记过至少一个 statepoint 调用点。
+    bool stackmap_has_call_sites();
+
+    // 沿帧指针链回溯当前线程的原生栈：每个停在 statepoint 上的栈帧，
+    // 按 stack map 记录的槽位读出其中的对象引用，追加到 seeds。
+    // 生成代码与运行时都必须保留帧指针，链才能从运行时一直接到生成代码。
+    void stackmap_collect_roots(std::vector<void*>& seeds);
+
+    // 同上，从另一个线程停下时记录的帧地址 frame_pointer 开始回溯，不越过 stack_top。
+    void stackmap_scan_stack(std::vector<void*>& seeds, uintptr_t frame_pointer, uintptr_t stack_top);
+}
+
+#endif // !SAKURAE_RUNTIME_STACKMAP_H
@@ -0,0 +1,340 @@
+/*
+    SakuraE Runtime Library
+    stats.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "stats.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gc.h"
+#include "heap.h"
+#include "thread.h"
+
+namespace sakuraE::runtime {
+    namespace {
+        // 停顿直方图：每个 2 的幂区间再均分成 4 个桶，小于 4ns 的停顿各占一个桶。
+        constexpr size_t PAUSE_SUB_BUCKETS = 4;
+        constexpr size_t PAUSE_BUCKETS = 64 * PAUSE_SUB_BUCKETS;
+
+        constexpr size_t UNKNOWN_LIVE = SIZE_MAX;
+
+        struct GCCycleRecord {
+            GCCycleKind kind;
+            uint64_t pause_ns = 0;
+            uint64_t mark_ns = 0;
+            size_t roots = 0;
+            // 清扫完成之前未知。被放弃的增量周期永远不会清扫。
+            size_t live_bytes = UNKNOWN_LIVE;
+        };
+
+        struct StatsState {
+            std::vector<GCCycleRecord> cycles;
+            // 正在惰性清扫的那一轮在 cycles 中的下标。
+            size_t sweeping_cycle = SIZE_MAX;
+
+            uint64_t collections = 0;
+            uint64_t minor_collections = 0;
+            uint64_t mark_slices = 0;
+            uint64_t bytes_allocated = 0;
+            uint64_t bytes_freed = 0;
+            size_t live_bytes = 0;
+            size_t max_roots = 0;
+
+            std::array<uint64_t, PAUSE_BUCKETS> pause_histogram {};
+            uint64_t pause_count = 0;
+            uint64_t pause_total_ns = 0;
+            uint64_t pause_max_ns = 0;
+
+            uint64_t mark_ns = 0;
+            uint64_t sweep_ns = 0;
+
+            uint64_t compactions = 0;
+            uint64_t bytes_compacted = 0;
+            uint64_t compact_ns = 0;
+
+            std::string output;
+        };
+
+        const char* default_output() {
+            const char* value = std::getenv("SAKURAE_GC_STATS");
+            if (!value || std::strcmp(value, "0") == 0) {
+                return "";
+            }
+            return std::strcmp(value, "1") == 0 ? "-" : value;
+        }
+
+        // 和堆状态一样刻意不析构：退出时的报告发生在静态析构阶段。
+        StatsState& stats() {
+            static auto* stats_state = new StatsState { .output = default_output() };
+            return *stats_state;
+        }
+
+        size_t pause_bucket(uint64_t ns) {
+            if (ns < PAUSE_SUB_BUCKETS) {
+                return ns;
+            }
+
+            size_t exponent = 63 - __builtin_clzll(ns);
+            size_t sub = (ns >> (exponent - 2)) & (PAUSE_SUB_BUCKETS - 1);
+            return exponent * PAUSE_SUB_BUCKETS + sub;
+        }
+
+        // 桶内最大的停顿时长。
+        uint64_t pause_bucket_bound(size_t bucket) {
+            if (bucket < PAUSE_SUB_BUCKETS) {
+                return bucket;
+            }
+
+            size_t exponent = bucket / PAUSE_SUB_BUCKETS;
+            uint64_t sub = bucket % PAUSE_SUB_BUCKETS;
+            uint64_t width = uint64_t(1) << (exponent - 2);
+            return (PAUSE_SUB_BUCKETS + sub) * width + width - 1;
+        }
+
+        uint64_t pause_percentile(const StatsState& state, double p) {
+            if (state.pause_count == 0) {
+                return 0;
+            }
+
+            uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(state.pause_count - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < PAUSE_BUCKETS; ++i) {
+                seen += state.pause_histogram[i];
+                if (seen >= rank) {
+                    return std::min(pause_bucket_bound(i), state.pause_max_ns);
+                }
+            }
+            return state.pause_max_ns;
+        }
+
+        GCCycleRecord* current_cycle() {
+            auto& cycles = stats().cycles;
+            return cycles.empty() ? nullptr : &cycles.back();
+        }
+
+        GCStats snapshot() {
+            const StatsState& state = stats();
+            const GCCycleRecord* last = state.cycles.empty() ? nullptr : &state.cycles.back();
+
+            GCStats result {};
+            result.collections = state.collections;
+            result.minor_collections = state.minor_collections;
+            result.mark_slices = state.mark_slices;
+            result.bytes_allocated = state.bytes_allocated;
+            result.bytes_freed = state.bytes_freed;
+            result.heap_bytes = allocated_bytes;
+            result.live_bytes = state.live_bytes;
+            result.root_count = last ? last->roots : 0;
+            result.max_root_count = state.max_roots;
+            result.pause_count = state.pause_count;
+            result.pause_total_ns = state.pause_total_ns;
+            result.pause_p50_ns = pause_percentile(state, 0.50);
+            result.pause_p99_ns = pause_percentile(state, 0.99);
+            result.pause_max_ns = state.pause_max_ns;
+            result.mark_ns = state.mark_ns;
+            result.sweep_ns = state.sweep_ns;
+            result.heap_limit = limit;
+            result.compactions = state.compactions;
+            result.bytes_compacted = state.bytes_compacted;
+            result.compact_ns = state.compact_ns;
+            result.large_object_bytes = heap_large_object_bytes();
+            result.bytes_released = heap_released_bytes();
+            return result;
+        }
+
+        const char* cycle_kind_name(GCCycleKind kind) {
+            switch (kind) {
+                case GCCycleKind::Full:
+                    return "full";
+                case GCCycleKind::Minor:
+                    return "minor";
+                case GCCycleKind::Incremental:
+                    return "incremental";
+            }
+            return "unknown";
+        }
+
+        void write_json(FILE* out, const GCStats& summary) {
+            const StatsState& state = stats();
+
+            std::fprintf(out, "{\n");
+            std::fprintf(out, "  \"collections\": %llu,\n", static_cast<unsigned long long>(summary.collections));
+            std::fprintf(out, "  \"minor_collections\": %llu,\n", static_cast<unsigned long long>(summary.minor_collections));
+            std::fprintf(out, "  \"mark_slices\": %llu,\n", static_cast<unsigned long long>(summary.mark_slices));
+            std::fprintf(out, "  \"bytes_allocated\": %llu,\n", static_cast<unsigned long long>(summary.bytes_allocated));
+            std::fprintf(out, "  \"bytes_freed\": %llu,\n", static_cast<unsigned long long>(summary.bytes_freed));
+            std::fprintf(out, "  \"heap_bytes\": %llu,\n", static_cast<unsigned long long>(summary.heap_bytes));
+            std::fprintf(out, "  \"live_bytes\": %llu,\n", static_cast<unsigned long long>(summary.live_bytes));
+            std::fprintf(out, "  \"heap_limit\": %llu,\n", static_cast<unsigned long long>(summary.heap_limit));
+            std::fprintf(out, "  \"large_object_bytes\": %llu,\n", static_cast<unsigned long long>(summary.large_object_bytes));
+            std::fprintf(out, "  \"bytes_released\": %llu,\n", static_cast<unsigned long long>(summary.bytes_released));
+            std::fprintf(out, "  \"roots\": { \"last\": %llu, \"max\": %llu },\n",
+                         static_cast<unsigned long long>(summary.root_count),
+                         static_cast<unsigned long long>(summary.max_root_count));
+            std::fprintf(out, "  \"mark_ns\": %llu,\n", static_cast<unsigned long long>(summary.mark_ns));
+            std::fprintf(out, "  \"sweep_ns\": %llu,\n", static_cast<unsigned long long>(summary.sweep_ns));
+            std::fprintf(out, "  \"compaction\": { \"count\": %llu, \"bytes\": %llu, \"ns\": %llu },\n",
+                         static_cast<unsigned long long>(summary.compactions),
+                         static_cast<unsigned long long>(summary.bytes_compacted),
+                         static_cast<unsigned long long>(summary.compact_ns));
+
+            std::fprintf(out, "  \"pause_ns\": {\n");
+            std::fprintf(out, "    \"count\": %llu,\n", static_cast<unsigned long long>(summary.pause_count));
+            std::fprintf(out, "    \"total\": %llu,\n", static_cast<unsigned long long>(summary.pause_total_ns));
+            std::fprintf(out, "    \"p50\": %llu,\n", static_cast<unsigned long long>(summary.pause_p50_ns));
+            std::fprintf(out, "    \"p99\": %llu,\n", static_cast<unsigned long long>(summary.pause_p99_ns));
+            std::fprintf(out, "    \"max\": %llu,\n", static_cast<unsigned long long>(summary.pause_max_ns));
+            std::fprintf(out, "    \"histogram\": [");
+            bool first = true;
+            for (size_t i = 0; i < PAUSE_BUCKETS; ++i) {
+                if (state.pause_histogram[i] == 0) {
+                    continue;
+                }
+                std::fprintf(out, "%s\n      { \"le\": %llu, \"count\": %llu }",
+                             first ? "" : ",",
+                             static_cast<unsigned long long>(pause_bucket_bound(i)),
+                             static_cast<unsigned long long>(state.pause_histogram[i]));
+                first = false;
+            }
+            std::fprintf(out, "%s]\n", first ? "" : "\n    ");
+            std::fprintf(out, "  },\n");
+
+            std::fprintf(out, "  \"cycles\": [");
+            for (size_t i = 0; i < state.cycles.size(); ++i) {
+                const GCCycleRecord& cycle = state.cycles[i];
+                std::fprintf(out, "%s\n    { \"kind\": \"%s\", \"pause_ns\": %llu, \"mark_ns\": %llu, \"roots\": %llu, \"live_bytes\": ",
+                             i == 0 ? "" : ",",
+                             cycle_kind_name(cycle.kind),
+                             static_cast<unsigned long long>(cycle.pause_ns),
+                             static_cast<unsigned long long>(cycle.mark_ns),
+                             static_cast<unsigned long long>(cycle.roots));
+                if (cycle.live_bytes == UNKNOWN_LIVE) {
+                    std::fprintf(out, "null }");
+                }
+                else {
+                    std::fprintf(out, "%llu }", static_cast<unsigned long long>(cycle.live_bytes));
+                }
+            }
+            std::fprintf(out, "%s]\n", state.cycles.empty() ? "" : "\n  ");
+            std::fprintf(out, "}\n");
+        }
+    }
+
+    void stats_begin_cycle(GCCycleKind kind) {
+        StatsState& state = stats();
+        state.cycles.push_back({ kind });
+
+        if (kind == GCCycleKind::Minor) {
+            ++state.minor_collections;
+        }
+        else {
+            ++state.collections;
+        }
+    }
+
+    void stats_record_roots(size_t count) {
+        StatsState& state = stats();
+        state.max_roots = std::max(state.max_roots, count);
+
+        if (GCCycleRecord* cycle = current_cycle()) {
+            cycle->roots = std::max(cycle->roots, count);
+        }
+    }
+
+    void stats_record_mark(uint64_t ns) {
+        stats().mark_ns += ns;
+        if (GCCycleRecord* cycle = current_cycle()) {
+            cycle->mark_ns += ns;
+        }
+    }
+
+    void stats_record_sweep(uint64_t ns) {
+        stats().sweep_ns += ns;
+    }
+
+    void stats_record_pause(uint64_t ns) {
+        StatsState& state = stats();
+        ++state.pause_histogram[pause_bucket(ns)];
+        ++state.pause_count;
+        state.pause_total_ns += ns;
+        state.pause_max_ns = std::max(state.pause_max_ns, ns);
+
+        if (GCCycleRecord* cycle = current_cycle()) {
+            cycle->pause_ns += ns;
+        }
+    }
+
+    void stats_record_mark_slice() {
+        ++stats().mark_slices;
+    }
+
+    void stats_record_compaction(size_t bytes, uint64_t ns) {
+        StatsState& state = stats();
+        ++state.compactions;
+        state.bytes_compacted += bytes;
+        state.compact_ns += ns;
+    }
+
+    void stats_record_allocated(size_t bytes) {
+        stats().bytes_allocated += bytes;
+    }
+
+    void stats_record_freed(size_t bytes) {
+        stats().bytes_freed += bytes;
+    }
+
+    void stats_begin_sweep() {
+        StatsState& state = stats();
+        state.sweeping_cycle = state.cycles.empty() ? SIZE_MAX : state.cycles.size() - 1;
+    }
+
+    void stats_record_live(size_t bytes) {
+        StatsState& state = stats();
+        state.live_bytes = bytes;
+
+        if (state.sweeping_cycle < state.cycles.size()) {
+            state.cycles[state.sweeping_cycle].live_bytes = bytes;
+        }
+        state.sweeping_cycle = SIZE_MAX;
+    }
+
+    void gc_set_stats_output(const char* path) {
+        stats().output = path ? path : "";
+    }
+
+    void stats_report_at_exit() {
+        const std::string& output = stats().output;
+        if (output.empty()) {
+            return;
+        }
+
+        GCStats summary = snapshot();
+        if (output == "-") {
+            write_json(stderr, summary);
+            return;
+        }
+
+        FILE* out = std::fopen(output.c_str(), "w");
+        if (!out) {
+            fprintf(stderr, "[Runtime Error] Failed to open GC stats output: %s\n", output.c_str());
+            return;
+        }
+        write_json(out, summary);
+        std::fclose(out);
+    }
+
+    extern "C" GCStats __gc_stats() {
+        GCLock lock(current_thread());
+        return snapshot();
+    }
+}
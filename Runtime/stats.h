@@ -0,0 +1,108 @@
+/*
+    SakuraE Runtime Library
+    stats.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_STATS_H
+#define SAKURAE_RUNTIME_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sakuraE::runtime {
+    // __gc_stats() 返回的快照。字段布局是对外 ABI，只在末尾追加新字段。
+    struct GCStats {
+        // full collection 次数，增量周期也算一次。
+        uint64_t collections;
+        // 分代模式下的 minor collection 次数。
+        uint64_t minor_collections;
+        // 增量标记的 slice 数。
+        uint64_t mark_slices;
+
+        // 程序开始以来累计分配 / 回收的字节数。
+        uint64_t bytes_allocated;
+        uint64_t bytes_freed;
+        // 当前记账中的堆占用，惰性清扫完成前包含还未清扫的死对象。
+        uint64_t heap_bytes;
+        // 最近一轮回收清扫完成后的存活字节数。
+        uint64_t live_bytes;
+
+        // 最近一轮回收以及历史最大的 root 数量。
+        uint64_t root_count;
+        uint64_t max_root_count;
+
+        // stop-the-world 停顿，包括等待其他线程停下的时间。
+        // 分位数来自对数分桶的直方图，是所在桶的上界，误差不超过 25%。
+        uint64_t pause_count;
+        uint64_t pause_total_ns;
+        uint64_t pause_p50_ns;
+        uint64_t pause_p99_ns;
+        uint64_t pause_max_ns;
+
+        // 标记与清扫的累计耗时。清扫大部分是惰性的，发生在分配慢路径上而不在停顿里。
+        uint64_t mark_ns;
+        uint64_t sweep_ns;
+
+        // 下一次 full collection 的触发阈值，由堆大小策略决定。
+        uint64_t heap_limit;
+
+        // 压缩次数、累计搬迁的字节数（按 cell 大小计）以及压缩耗时。
+        uint64_t compactions;
+        uint64_t bytes_compacted;
+        uint64_t compact_ns;
+
+        // 大对象空间当前占用的字节数，已包含在 heap_bytes 中。
+        uint64_t large_object_bytes;
+        // 累计还给操作系统的字节数：madvise 掉的空闲 chunk 加上 munmap 掉的大对象。
+        uint64_t bytes_released;
+    };
+
+    enum class GCCycleKind: uint8_t {
+        Full,
+        Minor,
+        Incremental
+    };
+
+    // 计时辅助，统计里的时间都以纳秒为单位。
+    class GCStatsTimer {
+    public:
+        GCStatsTimer(): begin(std::chrono::steady_clock::now()) {}
+
+        uint64_t elapsed_ns() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point begin;
+    };
+
+    // 以下记录接口由 gc.cpp 在持有 GC 锁时调用。
+    // 开始一轮新的回收，之后的 root 数、标记时间和停顿都计入这一轮。
+    void stats_begin_cycle(GCCycleKind kind);
+    void stats_record_roots(size_t count);
+    void stats_record_mark(uint64_t ns);
+    void stats_record_sweep(uint64_t ns);
+    void stats_record_pause(uint64_t ns);
+    void stats_record_mark_slice();
+    void stats_record_compaction(size_t bytes, uint64_t ns);
+    void stats_record_allocated(size_t bytes);
+    void stats_record_freed(size_t bytes);
+    // 当前这一轮开始清扫；清扫完成时调用 stats_record_live，把存活量记到这一轮上。
+    void stats_begin_sweep();
+    void stats_record_live(size_t bytes);
+
+    // 进程退出时输出统计：path 为 "-" 时打印到 stderr，否则写成 JSON 文件；空字符串表示关闭。
+    // 默认值来自环境变量 SAKURAE_GC_STATS（"1" 等价于 "-"）。
+    void gc_set_stats_output(const char* path);
+    // 按 gc_set_stats_output 的设置输出一次统计，GCCleaner 在释放堆之前调用。
+    void stats_report_at_exit();
+
+    // 取一份当前统计的快照，程序和基准测试可以随时调用。
+    extern "C" GCStats __gc_stats();
+}
+
+#endif // !SAKURAE_RUNTIME_STATS_H
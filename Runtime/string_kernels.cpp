@@ -0,0 +1,516 @@
+/*
+    SakuraE Runtime Library
+    string_kernels.cpp
+    2026-10-17
+
+    By FZSGBall
+*/
+
+#include "string_kernels.h"
+
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace sakuraE::runtime {
+    namespace {
+        constexpr uint64_t ONES = 0x0101010101010101ull;
+        constexpr uint64_t HIGHS = 0x8080808080808080ull;
+        constexpr uint64_t LOWS = 0x7F7F7F7F7F7F7F7Full;
+
+        inline uint64_t load64(const char* p) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            return word;
+        }
+
+        // 长度未知时按对齐的字读取，可能越过结尾的 NUL；对齐读取不会跨页，所以是安全的。
+        __attribute__((no_sanitize("address")))
+        inline uint64_t load64_aligned(const char* p) {
+            return *reinterpret_cast<const uint64_t*>(p);
+        }
+
+        // 为 0 的字节最高位置 1，其余为 0。不借位，所以高位字节也不会被误报。
+        inline uint64_t zero_bytes(uint64_t word) {
+            return ~(((word & LOWS) + LOWS) | word | LOWS);
+        }
+
+        // mask 中第一个（内存地址最小的）最高位为 1 的字节的下标。
+        inline size_t first_marked_byte(uint64_t mask) {
+            if constexpr (std::endian::native == std::endian::little) {
+                return std::countr_zero(mask) / 8;
+            }
+            else {
+                return std::countl_zero(mask) / 8;
+            }
+        }
+
+        inline int byte_order(char lhs, char rhs) {
+            return static_cast<unsigned char>(lhs) < static_cast<unsigned char>(rhs) ? -1 : 1;
+        }
+
+        inline int length_order(size_t lhs_length, size_t rhs_length) {
+            return lhs_length == rhs_length ? 0 : (lhs_length < rhs_length ? -1 : 1);
+        }
+
+        // ---------------- 可移植版本：每次处理 8 字节 ----------------
+
+        size_t portable_length(const char* str) {
+            const char* p = str;
+            for (; reinterpret_cast<uintptr_t>(p) & 7; ++p) {
+                if (!*p) return p - str;
+            }
+
+            for (;; p += 8) {
+                uint64_t mask = zero_bytes(load64_aligned(p));
+                if (mask) return p - str + first_marked_byte(mask);
+            }
+        }
+
+        bool portable_equal(const char* lhs, const char* rhs, size_t length) {
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                if (load64(lhs + i) != load64(rhs + i)) return false;
+            }
+            for (; i < length; ++i) {
+                if (lhs[i] != rhs[i]) return false;
+            }
+            return true;
+        }
+
+        int portable_compare(const char* lhs, size_t lhs_length, const char* rhs, size_t rhs_length) {
+            size_t length = lhs_length < rhs_length ? lhs_length : rhs_length;
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                uint64_t diff = load64(lhs + i) ^ load64(rhs + i);
+                if (diff) {
+                    // 把不同的位扩展成整字节的标记，再找第一个不同的字节。
+                    i += first_marked_byte(~zero_bytes(diff) & HIGHS);
+                    return byte_order(lhs[i], rhs[i]);
+                }
+            }
+            for (; i < length; ++i) {
+                if (lhs[i] != rhs[i]) return byte_order(lhs[i], rhs[i]);
+            }
+            return length_order(lhs_length, rhs_length);
+        }
+
+        const char* portable_find_char(const char* str, size_t length, char ch) {
+            uint64_t pattern = ONES * static_cast<unsigned char>(ch);
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                uint64_t mask = zero_bytes(load64(str + i) ^ pattern);
+                if (mask) return str + i + first_marked_byte(mask);
+            }
+            for (; i < length; ++i) {
+                if (str[i] == ch) return str + i;
+            }
+            return nullptr;
+        }
+
+        const char* portable_find(const char* str, size_t length, const char* needle, size_t needle_length) {
+            if (!needle_length) return str;
+            if (needle_length > length) return nullptr;
+
+            // 候选起点都在 [str, end) 里：先找首字节，再比较剩下的部分。
+            const char* end = str + length - needle_length + 1;
+            for (const char* p = str; p < end; ++p) {
+                p = portable_find_char(p, end - p, needle[0]);
+                if (!p) return nullptr;
+                if (portable_equal(p + 1, needle + 1, needle_length - 1)) return p;
+            }
+            return nullptr;
+        }
+
+        // 把 [first, last] 范围内的 ASCII 字母翻转大小写（异或 0x20）。
+        // 先去掉每个字节的最高位再做加法，字节之间不会进位；原来最高位为 1 的字节不是 ASCII，不参与转换。
+        void portable_flip_case(char* dst, const char* src, size_t length, char first, char last) {
+            uint64_t above_first = ONES * (0x80 - first);
+            uint64_t above_last = ONES * (0x80 - last - 1);
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8) {
+                uint64_t word = load64(src + i);
+                uint64_t low = word & LOWS;
+                uint64_t in_range = (low + above_first) & ~(low + above_last) & ~word & HIGHS;
+                word ^= in_range >> 2;
+                std::memcpy(dst + i, &word, sizeof(word));
+            }
+            for (; i < length; ++i) {
+                char ch = src[i];
+                dst[i] = ch >= first && ch <= last ? ch ^ 0x20 : ch;
+            }
+        }
+
+        void portable_to_lower(char* dst, const char* src, size_t length) {
+            portable_flip_case(dst, src, length, 'A', 'Z');
+        }
+
+        void portable_to_upper(char* dst, const char* src, size_t length) {
+            portable_flip_case(dst, src, length, 'a', 'z');
+        }
+
+        // 哈希：每次吸收 16 字节，做一次 64x64→128 位乘法再把高低两半异或折叠。
+        // 所有级别共用这一个实现，同一个字符串无论选了哪个级别都得到同一个哈希值。
+        constexpr uint64_t HASH_K0 = 0x9E3779B97F4A7C15ull;
+        constexpr uint64_t HASH_K1 = 0xC2B2AE3D27D4EB4Full;
+
+        inline uint64_t hash_mix(uint64_t lhs, uint64_t rhs) {
+            __uint128_t product = static_cast<__uint128_t>(lhs) * rhs;
+            return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+        }
+
+        uint64_t string_hash(const char* str, size_t length) {
+            uint64_t state = HASH_K0 ^ length;
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                state = hash_mix(load64(str + i) ^ HASH_K1, load64(str + i + 8) ^ state);
+            }
+
+            uint64_t tail[2] = { 0, 0 };
+            if (length > i) std::memcpy(tail, str + i, length - i);
+            state = hash_mix(tail[0] ^ HASH_K1, tail[1] ^ state);
+            return hash_mix(state ^ HASH_K0, length ^ HASH_K1);
+        }
+
+        constexpr StringKernels PORTABLE_KERNELS = {
+            StringKernelLevel::Portable,
+            portable_length,
+            portable_equal,
+            portable_compare,
+            portable_find_char,
+            portable_find,
+            string_hash,
+            portable_to_lower,
+            portable_to_upper
+        };
+
+#if defined(__x86_64__)
+        // ---------------- SSE2：x86-64 的基线，每次处理 16 字节 ----------------
+
+        inline uint32_t sse2_equal_mask(const char* lhs, const char* rhs) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+        }
+
+        inline uint32_t sse2_char_mask(const char* p, __m128i pattern) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern)));
+        }
+
+        // 从 str 所在的 16 字节对齐块开始读，再把 str 之前的位移掉；对齐读取不会跨页。
+        __attribute__((no_sanitize("address")))
+        size_t sse2_length(const char* str) {
+            const __m128i zero = _mm_setzero_si128();
+            uintptr_t offset = reinterpret_cast<uintptr_t>(str) & 15;
+            const char* p = str - offset;
+
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(p)), zero))) >> offset;
+            if (mask) return std::countr_zero(mask);
+
+            for (p += 16;; p += 16) {
+                mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(p)), zero)));
+                if (mask) return p - str + std::countr_zero(mask);
+            }
+        }
+
+        bool sse2_equal(const char* lhs, const char* rhs, size_t length) {
+            if (length < 16) return portable_equal(lhs, rhs, length);
+
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                if (sse2_equal_mask(lhs + i, rhs + i) != 0xFFFF) return false;
+            }
+            // 不足一块的尾巴用与前一块重叠的最后 16 字节比较。
+            return i == length || sse2_equal_mask(lhs + length - 16, rhs + length - 16) == 0xFFFF;
+        }
+
+        int sse2_compare(const char* lhs, size_t lhs_length, const char* rhs, size_t rhs_length) {
+            size_t length = lhs_length < rhs_length ? lhs_length : rhs_length;
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                uint32_t diff = sse2_equal_mask(lhs + i, rhs + i) ^ 0xFFFF;
+                if (diff) {
+                    i += std::countr_zero(diff);
+                    return byte_order(lhs[i], rhs[i]);
+                }
+            }
+            return portable_compare(lhs + i, lhs_length - i, rhs + i, rhs_length - i);
+        }
+
+        const char* sse2_find_char(const char* str, size_t length, char ch) {
+            const __m128i pattern = _mm_set1_epi8(ch);
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                uint32_t mask = sse2_char_mask(str + i, pattern);
+                if (mask) return str + i + std::countr_zero(mask);
+            }
+            return portable_find_char(str + i, length - i, ch);
+        }
+
+        // 一次检查 16 个候选起点：起点处等于 needle 的首字节、且对应的末字节位置等于 needle 的末字节，
+        // 两个条件都满足的候选才去比较中间部分。
+        const char* sse2_find(const char* str, size_t length, const char* needle, size_t needle_length) {
+            if (needle_length < 2) {
+                return needle_length ? sse2_find_char(str, length, needle[0]) : str;
+            }
+            if (needle_length > length) return nullptr;
+
+            const __m128i first = _mm_set1_epi8(needle[0]);
+            const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+            size_t i = 0;
+            for (; i + 16 + needle_length - 1 <= length; i += 16) {
+                uint32_t mask = sse2_char_mask(str + i, first) & sse2_char_mask(str + i + needle_length - 1, last);
+                for (; mask; mask &= mask - 1) {
+                    size_t pos = i + std::countr_zero(mask);
+                    if (sse2_equal(str + pos + 1, needle + 1, needle_length - 2)) return str + pos;
+                }
+            }
+            return portable_find(str + i, length - i, needle, needle_length);
+        }
+
+        // 大于 'A' - 1 且小于 'Z' + 1 的字节按有符号比较判断，最高位为 1 的字节是负数，天然被排除。
+        void sse2_flip_case(char* dst, const char* src, size_t length, char first, char last) {
+            const __m128i below = _mm_set1_epi8(static_cast<char>(first - 1));
+            const __m128i above = _mm_set1_epi8(static_cast<char>(last + 1));
+            const __m128i flip = _mm_set1_epi8(0x20);
+            size_t i = 0;
+            for (; i + 16 <= length; i += 16) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(block, below), _mm_cmplt_epi8(block, above));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(block, _mm_and_si128(in_range, flip)));
+            }
+            portable_flip_case(dst + i, src + i, length - i, first, last);
+        }
+
+        void sse2_to_lower(char* dst, const char* src, size_t length) {
+            sse2_flip_case(dst, src, length, 'A', 'Z');
+        }
+
+        void sse2_to_upper(char* dst, const char* src, size_t length) {
+            sse2_flip_case(dst, src, length, 'a', 'z');
+        }
+
+        constexpr StringKernels SSE2_KERNELS = {
+            StringKernelLevel::SSE2,
+            sse2_length,
+            sse2_equal,
+            sse2_compare,
+            sse2_find_char,
+            sse2_find,
+            string_hash,
+            sse2_to_lower,
+            sse2_to_upper
+        };
+
+        // ---------------- AVX2：每次处理 32 字节，只在 CPUID 报告支持时使用 ----------------
+        // 这些函数单独以 avx2 为目标编译，其余代码仍然只假定 SSE2。不足 32 字节的部分交给 SSE2 版本。
+
+        __attribute__((target("avx2")))
+        inline uint32_t avx2_equal_mask(const char* lhs, const char* rhs) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+        }
+
+        __attribute__((target("avx2")))
+        inline uint32_t avx2_char_mask(const char* p, __m256i pattern) {
+            __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern)));
+        }
+
+        __attribute__((target("avx2"), no_sanitize("address")))
+        size_t avx2_length(const char* str) {
+            const __m256i zero = _mm256_setzero_si256();
+            uintptr_t offset = reinterpret_cast<uintptr_t>(str) & 31;
+            const char* p = str - offset;
+
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(p)), zero))) >> offset;
+            if (mask) return std::countr_zero(mask);
+
+            for (p += 32;; p += 32) {
+                mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(p)), zero)));
+                if (mask) return p - str + std::countr_zero(mask);
+            }
+        }
+
+        __attribute__((target("avx2")))
+        bool avx2_equal(const char* lhs, const char* rhs, size_t length) {
+            if (length < 32) return sse2_equal(lhs, rhs, length);
+
+            size_t i = 0;
+            for (; i + 32 <= length; i += 32) {
+                if (avx2_equal_mask(lhs + i, rhs + i) != 0xFFFFFFFFu) return false;
+            }
+            return i == length || avx2_equal_mask(lhs + length - 32, rhs + length - 32) == 0xFFFFFFFFu;
+        }
+
+        __attribute__((target("avx2")))
+        int avx2_compare(const char* lhs, size_t lhs_length, const char* rhs, size_t rhs_length) {
+            size_t length = lhs_length < rhs_length ? lhs_length : rhs_length;
+            size_t i = 0;
+            for (; i + 32 <= length; i += 32) {
+                uint32_t diff = ~avx2_equal_mask(lhs + i, rhs + i);
+                if (diff) {
+                    i += std::countr_zero(diff);
+                    return byte_order(lhs[i], rhs[i]);
+                }
+            }
+            return sse2_compare(lhs + i, lhs_length - i, rhs + i, rhs_length - i);
+        }
+
+        __attribute__((target("avx2")))
+        const char* avx2_find_char(const char* str, size_t length, char ch) {
+            const __m256i pattern = _mm256_set1_epi8(ch);
+            size_t i = 0;
+            for (; i + 32 <= length; i += 32) {
+                uint32_t mask = avx2_char_mask(str + i, pattern);
+                if (mask) return str + i + std::countr_zero(mask);
+            }
+            return sse2_find_char(str + i, length - i, ch);
+        }
+
+        __attribute__((target("avx2")))
+        const char* avx2_find(const char* str, size_t length, const char* needle, size_t needle_length) {
+            if (needle_length < 2) {
+                return needle_length ? avx2_find_char(str, length, needle[0]) : str;
+            }
+            if (needle_length > length) return nullptr;
+
+            const __m256i first = _mm256_set1_epi8(needle[0]);
+            const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+            size_t i = 0;
+            for (; i + 32 + needle_length - 1 <= length; i += 32) {
+                uint32_t mask = avx2_char_mask(str + i, first) & avx2_char_mask(str + i + needle_length - 1, last);
+                for (; mask; mask &= mask - 1) {
+                    size_t pos = i + std::countr_zero(mask);
+                    if (avx2_equal(str + pos + 1, needle + 1, needle_length - 2)) return str + pos;
+                }
+            }
+            return sse2_find(str + i, length - i, needle, needle_length);
+        }
+
+        __attribute__((target("avx2")))
+        void avx2_flip_case(char* dst, const char* src, size_t length, char first, char last) {
+            const __m256i below = _mm256_set1_epi8(static_cast<char>(first - 1));
+            const __m256i above = _mm256_set1_epi8(static_cast<char>(last + 1));
+            const __m256i flip = _mm256_set1_epi8(0x20);
+            size_t i = 0;
+            for (; i + 32 <= length; i += 32) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+                __m256i in_range = _mm256_and_si256(_mm256_cmpgt_epi8(block, below), _mm256_cmpgt_epi8(above, block));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(block, _mm256_and_si256(in_range, flip)));
+            }
+            sse2_flip_case(dst + i, src + i, length - i, first, last);
+        }
+
+        __attribute__((target("avx2")))
+        void avx2_to_lower(char* dst, const char* src, size_t length) {
+            avx2_flip_case(dst, src, length, 'A', 'Z');
+        }
+
+        __attribute__((target("avx2")))
+        void avx2_to_upper(char* dst, const char* src, size_t length) {
+            avx2_flip_case(dst, src, length, 'a', 'z');
+        }
+
+        constexpr StringKernels AVX2_KERNELS = {
+            StringKernelLevel::AVX2,
+            avx2_length,
+            avx2_equal,
+            avx2_compare,
+            avx2_find_char,
+            avx2_find,
+            string_hash,
+            avx2_to_lower,
+            avx2_to_upper
+        };
+#endif
+    }
+
+    const StringKernels* string_kernels = &PORTABLE_KERNELS;
+
+    StringKernelLevel string_kernels_best_level() {
+#if defined(__x86_64__)
+        // __builtin_cpu_supports 读 CPUID，并确认操作系统会保存 YMM 寄存器。
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return StringKernelLevel::AVX2;
+        }
+        return StringKernelLevel::SSE2;
+#else
+        return StringKernelLevel::Portable;
+#endif
+    }
+
+    StringKernelLevel string_kernels_select(StringKernelLevel level) {
+        StringKernelLevel best = string_kernels_best_level();
+        if (level > best) {
+            level = best;
+        }
+
+        switch (level) {
+#if defined(__x86_64__)
+            case StringKernelLevel::AVX2:
+                string_kernels = &AVX2_KERNELS;
+                break;
+            case StringKernelLevel::SSE2:
+                string_kernels = &SSE2_KERNELS;
+                break;
+#endif
+            default:
+                string_kernels = &PORTABLE_KERNELS;
+                break;
+        }
+        return string_kernels->level;
+    }
+
+    bool string_kernels_parse_level(const char* name, StringKernelLevel& level) {
+        if (!name) {
+            return false;
+        }
+
+        if (std::strcmp(name, "portable") == 0) {
+            level = StringKernelLevel::Portable;
+        }
+        else if (std::strcmp(name, "sse2") == 0) {
+            level = StringKernelLevel::SSE2;
+        }
+        else if (std::strcmp(name, "avx2") == 0) {
+            level = StringKernelLevel::AVX2;
+        }
+        else {
+            return false;
+        }
+        return true;
+    }
+
+    const char* string_kernels_level_name(StringKernelLevel level) {
+        switch (level) {
+            case StringKernelLevel::AVX2:
+                return "avx2";
+            case StringKernelLevel::SSE2:
+                return "sse2";
+            default:
+                return "portable";
+        }
+    }
+
+    namespace {
+        // 进程启动时选定级别。设置了 SAKURAE_STRING_KERNELS 时用它指定的级别（仍不超过本机支持的级别），
+        // 方便在同一台机器上测试和比较各个版本。
+        struct StringKernelsInit {
+            StringKernelsInit() {
+                StringKernelLevel level = string_kernels_best_level();
+                string_kernels_parse_level(std::getenv("SAKURAE_STRING_KERNELS"), level);
+                string_kernels_select(level);
+            }
+        };
+
+        StringKernelsInit string_kernels_init;
+    }
+}
@@ -0,0 +1,58 @@
+/*
+    SakuraE Runtime Library
+    string_kernels.h
+    2026-10-17
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_STRING_KERNELS_H
+#define SAKURAE_RUNTIME_STRING_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sakuraE::runtime {
+    // 字符串的基础操作：每个操作有 AVX2、SSE2 和可移植（按 8 字节一次的 SWAR）三个版本。
+    // 启动时按 CPUID 选出本机支持的最高一级，之后所有调用都经过同一张函数表。
+    // 除了 length 以外都按显式长度处理，不依赖结尾的 NUL，中间含 NUL 的字符串也能正确处理。
+    enum class StringKernelLevel: uint8_t {
+        Portable,
+        SSE2,
+        AVX2
+    };
+
+    struct StringKernels {
+        StringKernelLevel level;
+
+        // 扫描到 NUL 为止的长度，只给普通 C 字符串用；字符串对象的长度直接读 header。
+        size_t (*length)(const char* str);
+        // 两段长度相同的字符是否逐字节相等。
+        bool (*equal)(const char* lhs, const char* rhs, size_t length);
+        // 按无符号字节的字典序比较，返回 -1 / 0 / 1；一段是另一段的前缀时短的更小。
+        int (*compare)(const char* lhs, size_t lhs_length, const char* rhs, size_t rhs_length);
+        // 第一次出现的位置，找不到返回 nullptr；空的 needle 匹配开头。
+        const char* (*find_char)(const char* str, size_t length, char ch);
+        const char* (*find)(const char* str, size_t length, const char* needle, size_t needle_length);
+        // 各个版本共用同一个实现，结果与所选的级别无关。
+        uint64_t (*hash)(const char* str, size_t length);
+        // 只转换 ASCII 字母，其他字节原样拷贝。dst 与 src 可以是同一块内存。
+        void (*to_lower)(char* dst, const char* src, size_t length);
+        void (*to_upper)(char* dst, const char* src, size_t length);
+    };
+
+    // 当前使用的函数表。进程启动时按 CPU 和环境变量 SAKURAE_STRING_KERNELS 选定，
+    // 在那之前（其他翻译单元的静态初始化期间）指向可移植版本。
+    extern const StringKernels* string_kernels;
+
+    // 本机 CPU 支持的最高级别。
+    StringKernelLevel string_kernels_best_level();
+    // 切换到 level，超过本机支持的级别时退回最高可用级别，返回实际使用的级别。
+    // 只应在程序开始运行之前调用，运行中切换不会与其他线程同步。
+    StringKernelLevel string_kernels_select(StringKernelLevel level);
+    // 解析 "portable" / "sse2" / "avx2"，不认识的名字返回 false。
+    bool string_kernels_parse_level(const char* name, StringKernelLevel& level);
+    const char* string_kernels_level_name(StringKernelLevel level);
+}
+
+#endif // !SAKURAE_RUNTIME_STRING_KERNELS_H
@@ -0,0 +1,207 @@
+/*
+    SakuraE Runtime Library
+    thread.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#include "thread.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+#include "native_stack.h"
+
+namespace sakuraE::runtime {
+    uint8_t __gc_safepoint_requested = 0;
+
+    namespace {
+        std::mutex gc_mutex;
+        // 以下状态受 gc_mutex 保护。
+        std::vector<GCThread*> threads;
+
+        std::mutex safepoint_mutex;
+        std::condition_variable safepoint_cv;
+        // 以下状态受 safepoint_mutex 保护。
+        bool stop_requested = false;
+        bool marking_requested = false;
+
+        thread_local GCThread* this_thread = nullptr;
+
+        // 线程退出时自动注销，忘记调用 __gc_destroy_thread 的线程也不会在登记表里留下悬空指针。
+        struct ThreadExitGuard {
+            ~ThreadExitGuard() {
+                __gc_destroy_thread();
+            }
+        };
+        thread_local ThreadExitGuard exit_guard;
+
+        // 生成代码用 monotonic load 轮询这个标志。调用方持有 safepoint_mutex。
+        void publish_safepoint_flag() {
+            __atomic_store_n(&__gc_safepoint_requested, (stop_requested || marking_requested) ? 1 : 0, __ATOMIC_RELAXED);
+        }
+
+        __attribute__((noinline))
+        uintptr_t current_stack_position() {
+            return reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        }
+
+        // 把 callee-saved 寄存器保存进调用方的栈帧，并记录一个位于它们下方的栈位置。
+        // 必须内联进一个在停下期间始终留在栈上的函数：frame_pointer 记录的就是那个函数的帧。
+        __attribute__((always_inline))
+        inline void record_stack(GCThread* self) {
+            __builtin_unwind_init();
+            self->stack_bottom = current_stack_position();
+            self->frame_pointer = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        }
+
+        bool others_parked(GCThread* self) {
+            return std::all_of(threads.begin(), threads.end(), [self](GCThread* thread) {
+                return thread == self || thread->parked;
+            });
+        }
+
+        GCThread* register_current_thread() {
+            auto* self = new GCThread {};
+            self->stack_top = native_stack_top();
+
+            // 还没有登记的线程不会被 stop-the-world 等待，所以这里可以直接阻塞在 GC 锁上。
+            {
+                std::lock_guard<std::mutex> lock(gc_mutex);
+                threads.push_back(self);
+            }
+
+            this_thread = self;
+            (void)&exit_guard;
+            return self;
+        }
+    }
+
+    GCThread* current_thread() {
+        if (this_thread) {
+            return this_thread;
+        }
+        return register_current_thread();
+    }
+
+    const std::vector<GCThread*>& gc_threads() {
+        return threads;
+    }
+
+    GCLock::GCLock(GCThread* self) {
+        if (gc_mutex.try_lock()) {
+            return;
+        }
+
+        // 锁被占用时持有者可能正在等所有线程停下：先把自己标记为已停下再阻塞。
+        record_stack(self);
+        {
+            std::lock_guard<std::mutex> lock(safepoint_mutex);
+            self->parked = true;
+        }
+        safepoint_cv.notify_all();
+
+        gc_mutex.lock();
+
+        // 拿到 GC 锁说明没有回收器在 stop-the-world 中，可以直接恢复运行。
+        std::lock_guard<std::mutex> lock(safepoint_mutex);
+        self->parked = false;
+    }
+
+    GCLock::~GCLock() {
+        gc_mutex.unlock();
+    }
+
+    StopTheWorld::StopTheWorld(GCThread* self) {
+        if (threads.size() <= 1) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(safepoint_mutex);
+        stop_requested = true;
+        stopped = true;
+        publish_safepoint_flag();
+
+        safepoint_cv.wait(lock, [self] { return others_parked(self); });
+    }
+
+    StopTheWorld::~StopTheWorld() {
+        if (!stopped) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(safepoint_mutex);
+            stop_requested = false;
+            publish_safepoint_flag();
+        }
+        safepoint_cv.notify_all();
+    }
+
+    void safepoint_park(GCThread* self) {
+        std::unique_lock<std::mutex> lock(safepoint_mutex);
+        if (!stop_requested) {
+            return;
+        }
+
+        record_stack(self);
+        self->parked = true;
+        safepoint_cv.notify_all();
+
+        safepoint_cv.wait(lock, [] { return !stop_requested; });
+        self->parked = false;
+    }
+
+    void safepoint_request_marking(bool requested) {
+        std::lock_guard<std::mutex> lock(safepoint_mutex);
+        marking_requested = requested;
+        publish_safepoint_flag();
+    }
+
+    extern "C" void __gc_enter_blocking() {
+        GCThread* self = current_thread();
+        record_stack(self);
+        // 返回之后线程继续运行，本函数的帧随即失效，所以从调用方的帧开始回溯。
+        // 只有原生代码会调用它，这次调用本身不是 statepoint 调用点。
+        self->frame_pointer = *reinterpret_cast<uintptr_t*>(self->frame_pointer);
+        {
+            std::lock_guard<std::mutex> lock(safepoint_mutex);
+            self->parked = true;
+        }
+        safepoint_cv.notify_all();
+    }
+
+    extern "C" void __gc_leave_blocking() {
+        GCThread* self = current_thread();
+        std::unique_lock<std::mutex> lock(safepoint_mutex);
+        safepoint_cv.wait(lock, [] { return !stop_requested; });
+        self->parked = false;
+    }
+
+    extern "C" GCThreadContext* __gc_current_thread() {
+        return &current_thread()->context;
+    }
+
+    extern "C" void __gc_create_thread() {
+        current_thread();
+    }
+
+    extern "C" void __gc_destroy_thread() {
+        GCThread* self = this_thread;
+        if (!self) {
+            return;
+        }
+
+        {
+            GCLock lock(self);
+            // 已经切出去的 cell 会在下一次记账时计入 allocated_bytes。
+            heap_flush_alloc_buffers(self->context.alloc_buffers);
+            threads.erase(std::find(threads.begin(), threads.end(), self));
+        }
+
+        this_thread = nullptr;
+        delete self;
+    }
+}
@@ -0,0 +1,93 @@
+/*
+    SakuraE Runtime Library
+    thread.h
+    2026-10-16
+
+    By FZSGBall
+*/
+
+#ifndef SAKURAE_RUNTIME_THREAD_H
+#define SAKURAE_RUNTIME_THREAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "arena.h"
+#include "gc.h"
+#include "heap.h"
+
+namespace sakuraE::runtime {
+    // 生成代码直接读写的线程状态，__gc_current_thread 返回它的地址。
+    // 字段偏移是 codegen 与运行时之间的约定，修改时两边要一起改。
+    struct GCThreadContext {
+        // 本线程 frame record 链表头，指向最内层函数的 GCFrame。
+        GCFrame* frame_top = nullptr;
+        // 每个 size class 一个分配缓冲区。
+        GCAllocBuffer alloc_buffers[HEAP_SIZE_CLASS_COUNT] = {};
+        // arena 后端的 bump 区间，其他后端下始终为空。
+        GCArenaBuffer arena = {};
+    };
+
+    // 一个已登记的 mutator 线程。除 context 外的字段只由运行时访问。
+    struct GCThread {
+        GCThreadContext context;
+
+        // 原生代码通过 __gc_register 登记的显式 root stack，保存的是“槽位地址”。
+        std::vector<void**> roots;
+        // 每次进入一个词法作用域时记录 root stack 的深度，离开作用域后直接回退即可。
+        std::vector<size_t> scope_markers;
+
+        // 原生栈的最高地址，登记时在线程自己身上查询。
+        uintptr_t stack_top = 0;
+        // 停下时记录的栈位置（低地址端），此时 callee-saved 寄存器已经压在它上方。
+        uintptr_t stack_bottom = 0;
+        // 停下时所在运行时函数的帧地址，停下期间一直有效，statepoint 模式从这里沿帧指针链回溯。
+        uintptr_t frame_pointer = 0;
+        // 停在 safe point 上，或正在等待 GC 锁。受 safepoint 互斥量保护。
+        bool parked = false;
+    };
+
+    // 当前线程的 GCThread，第一次调用时自动登记。
+    GCThread* current_thread();
+
+    // 所有已登记的 mutator 线程。调用方必须持有 GC 锁。
+    const std::vector<GCThread*>& gc_threads();
+
+    // GC 锁：保护堆、记账、类型池以及回收器状态。
+    // mutator 等待这把锁期间被视为已经停下，因此不会和正在 stop-the-world 的回收器互相等待。
+    class GCLock {
+    public:
+        explicit GCLock(GCThread* self);
+        ~GCLock();
+
+        GCLock(const GCLock&) = delete;
+        GCLock& operator=(const GCLock&) = delete;
+    };
+
+    // 持有 GC 锁时使用：构造时请求其他 mutator 在下一个 safe point 停下并等待它们全部停下，
+    // 析构时放行。只有一个线程时什么也不做。
+    class StopTheWorld {
+    public:
+        explicit StopTheWorld(GCThread* self);
+        ~StopTheWorld();
+
+        StopTheWorld(const StopTheWorld&) = delete;
+        StopTheWorld& operator=(const StopTheWorld&) = delete;
+
+    private:
+        bool stopped = false;
+    };
+
+    // safe point 上调用：有 stop-the-world 请求时停下，直到回收器放行。
+    void safepoint_park(GCThread* self);
+
+    // 增量标记期间需要 mutator 经常进入 __gc_safe_point 推进标记。
+    // __gc_safepoint_requested 是这个请求与 stop-the-world 请求的并集。
+    void safepoint_request_marking(bool requested);
+
+    // 返回当前线程的 GCThreadContext，生成代码在函数入口调用一次。
+    extern "C" GCThreadContext* __gc_current_thread();
+}
+
+#endif // !SAKURAE_RUNTIME_THREAD_H
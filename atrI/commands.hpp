@@ -1,6 +1,7 @@
 #ifndef SAKURAE_ATRI_COMMANDS_HPP
 #define SAKURAE_ATRI_COMMANDS_HPP
 
+#include <cstring>
 #include <ctime>
 #include <iostream>
 #include <llvm/ExecutionEngine/Orc/CoreContainers.h>
@@ -17,12 +18,19 @@
 #include <llvm/ExecutionEngine/GenericValue.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
 #include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #include <llvm/Support/TargetSelect.h>
 #include "Runtime/alloc.h"
+#include "Runtime/arena.h"
 #include "Runtime/gc.h"
 #include "Runtime/raw_string.h"
 #include "Runtime/print.h"
+#include "Runtime/profile.h"
+#include "Runtime/stackmap.h"
+#include "Runtime/stats.h"
+#include "Runtime/thread.h"
 
 
 #include "Compiler/Frontend/lexer.h"
@@ -43,6 +51,33 @@ namespace atri::cmds {
         exit(0);
     }
 
+    // JIT 目标文件的内存管理器：额外记下 .llvm_stackmaps 段，
+    // 重定位完成（finalizeMemory）后交给运行时解析，供 statepoint 模式的 GC 遍历栈帧。
+    class StackMapMemoryManager: public llvm::SectionMemoryManager {
+        uint8_t* stackMapSection = nullptr;
+        uintptr_t stackMapSize = 0;
+    public:
+        uint8_t* allocateDataSection(uintptr_t size, unsigned alignment, unsigned sectionID,
+                                     llvm::StringRef sectionName, bool isReadOnly) override {
+            uint8_t* addr = llvm::SectionMemoryManager::allocateDataSection(size, alignment, sectionID, sectionName, isReadOnly);
+            if (sectionName == ".llvm_stackmaps") {
+                stackMapSection = addr;
+                stackMapSize = size;
+            }
+            return addr;
+        }
+
+        bool finalizeMemory(std::string* errMsg = nullptr) override {
+            if (llvm::SectionMemoryManager::finalizeMemory(errMsg)) return true;
+
+            if (stackMapSection) {
+                sakuraE::runtime::__gc_register_stackmap(stackMapSection, stackMapSize);
+                stackMapSection = nullptr;
+            }
+            return false;
+        }
+    };
+
     inline void cmdRun(std::vector<fzlib::String> args) {
         CompilerSessionGuard compilerSessionGuard;
 
@@ -63,6 +98,76 @@ namespace atri::cmds {
         if (contains(args, "-rawllvm")) { config.displayRawLLVMIR = true; isDebug = true; }
         if (contains(args, "-llvmir")) { config.displayOptimizedLLVMIR = true; isDebug = true; }
 
+        // -gc=marksweep|gen|arena 选择 GC 后端；-gc-gen 是 -gc=gen 的旧写法，两者同时出现时以 -gc= 为准。
+        if (contains(args, "-gc-gen")) sakuraE::runtime::gc_set_generational(true);
+        std::string gcBackend;
+        if (findOptionValue(args, "-gc=", gcBackend)) {
+            sakuraE::runtime::GCBackend backend;
+            if (!sakuraE::runtime::gc_parse_backend(gcBackend.c_str(), backend)) throw std::runtime_error(("Unknown GC backend: " + gcBackend).c_str());
+            sakuraE::runtime::gc_set_backend(backend);
+        }
+        bool useArena = sakuraE::runtime::gc_backend() == sakuraE::runtime::GCBackend::Arena;
+
+        std::string gcThreads;
+        if (findOptionValue(args, "-gc-threads=", gcThreads)) {
+            sakuraE::runtime::gc_set_mark_threads(std::strtoul(gcThreads.c_str(), nullptr, 10));
+        }
+
+        std::string gcPauseUs;
+        if (findOptionValue(args, "-gc-pause-us=", gcPauseUs)) {
+            sakuraE::runtime::gc_set_pause_budget_us(std::strtoul(gcPauseUs.c_str(), nullptr, 10));
+        }
+        if (contains(args, "-gc-incremental")) sakuraE::runtime::gc_set_incremental(true);
+
+        // -gc-compact 在碎片率超过阈值（默认 0.5）的 full collection 之后搬迁稀疏 chunk 里的对象。
+        if (contains(args, "-gc-compact")) sakuraE::runtime::gc_set_compact(true);
+        std::string gcCompactThreshold;
+        if (findOptionValue(args, "-gc-compact-threshold=", gcCompactThreshold)) {
+            sakuraE::runtime::gc_set_compact_threshold(std::strtod(gcCompactThreshold.c_str(), nullptr));
+        }
+
+        // 堆大小策略：大小可以带 K / M / G 后缀，例如 -gc-max-heap=512M。
+        std::string gcInitialHeap;
+        if (findOptionValue(args, "-gc-initial-heap=", gcInitialHeap)) {
+            sakuraE::runtime::gc_set_initial_heap(sakuraE::runtime::gc_parse_bytes(gcInitialHeap.c_str()));
+        }
+        std::string gcMaxHeap;
+        if (findOptionValue(args, "-gc-max-heap=", gcMaxHeap)) {
+            sakuraE::runtime::gc_set_max_heap(sakuraE::runtime::gc_parse_bytes(gcMaxHeap.c_str()));
+        }
+        std::string gcGrowth;
+        if (findOptionValue(args, "-gc-growth=", gcGrowth)) {
+            sakuraE::runtime::gc_set_growth_factor(std::strtod(gcGrowth.c_str(), nullptr));
+        }
+        std::string gcTimeRatio;
+        if (findOptionValue(args, "-gc-time-ratio=", gcTimeRatio)) {
+            sakuraE::runtime::gc_set_gc_time_ratio(std::strtod(gcTimeRatio.c_str(), nullptr));
+        }
+
+        // -gc-stats 在退出时把 GC 统计以 JSON 打印到 stderr，-gc-stats=<path> 则写入文件。
+        std::string gcStats;
+        if (findOptionValue(args, "-gc-stats=", gcStats)) sakuraE::runtime::gc_set_stats_output(gcStats.c_str());
+        else if (contains(args, "-gc-stats")) sakuraE::runtime::gc_set_stats_output("-");
+
+        // -gc-profile=<path> 开启采样堆 profiler，退出时把按分配点汇总的 pprof profile 写入文件。
+        std::string gcProfile;
+        if (findOptionValue(args, "-gc-profile=", gcProfile)) sakuraE::runtime::gc_set_profile_output(gcProfile.c_str());
+        std::string gcProfileRate;
+        if (findOptionValue(args, "-gc-profile-rate=", gcProfileRate)) {
+            sakuraE::runtime::gc_set_profile_rate(std::strtoull(gcProfileRate.c_str(), nullptr, 10));
+        }
+
+        auto gcRootStrategy = sakuraE::Codegen::LLVMCodeGenerator::GCRootStrategy::ShadowStack;
+        std::string gcRoots;
+        if (findOptionValue(args, "-gc-roots=", gcRoots)) {
+            if (gcRoots == "statepoint") gcRootStrategy = sakuraE::Codegen::LLVMCodeGenerator::GCRootStrategy::Statepoint;
+            else if (gcRoots == "conservative") gcRootStrategy = sakuraE::Codegen::LLVMCodeGenerator::GCRootStrategy::Conservative;
+            else if (gcRoots != "shadow-stack") throw std::runtime_error(("Unknown GC root strategy: " + gcRoots).c_str());
+        }
+        // arena 后端从不回收，生成代码里不需要任何 root、safe point 或 write barrier。
+        if (useArena) gcRootStrategy = sakuraE::Codegen::LLVMCodeGenerator::GCRootStrategy::None;
+        sakuraE::runtime::gc_set_conservative_stack(gcRootStrategy == sakuraE::Codegen::LLVMCodeGenerator::GCRootStrategy::Conservative);
+
         std::ostringstream log;
 
         sakuraE::Lexer lexer(content);
@@ -99,6 +204,7 @@ namespace atri::cmds {
         auto& program = generator.getProgram();
 
         sakuraE::Codegen::LLVMCodeGenerator llvmCodegen(&program);
+        llvmCodegen.setGCRootStrategy(gcRootStrategy);
         llvmCodegen.start();
 
         if (config.displayRawLLVMIR) {
@@ -121,7 +227,13 @@ namespace atri::cmds {
         llvm::InitializeNativeTargetAsmPrinter();
         llvm::InitializeNativeTargetAsmParser();
 
-        auto JIT = llvm::cantFail(llvm::orc::LLJITBuilder().create());
+        auto JIT = llvm::cantFail(llvm::orc::LLJITBuilder()
+            .setObjectLinkingLayerCreator([](llvm::orc::ExecutionSession& ES, const llvm::Triple&) {
+                return std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(ES, []() {
+                    return std::make_unique<StackMapMemoryManager>();
+                });
+            })
+            .create());
 
         auto& JD = JIT->getMainJITDylib();
         llvm::orc::SymbolMap runtimeSymbols;
@@ -131,14 +243,34 @@ namespace atri::cmds {
         runtimeSymbols[JIT->mangleAndIntern("create_string")] = { llvm::orc::ExecutorAddr::fromPtr(&create_string), llvm::JITSymbolFlags::Exported };
         runtimeSymbols[JIT->mangleAndIntern("free_string")] = { llvm::orc::ExecutorAddr::fromPtr(&free_string), llvm::JITSymbolFlags::Exported };
         runtimeSymbols[JIT->mangleAndIntern("concat_string")] = { llvm::orc::ExecutorAddr::fromPtr(&concat_string), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__create_string")] = { llvm::orc::ExecutorAddr::fromPtr(&__create_string), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__concat_string")] = { llvm::orc::ExecutorAddr::fromPtr(&__concat_string), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_make_mutable")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_make_mutable), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__concat_n")] = { llvm::orc::ExecutorAddr::fromPtr(&__concat_n), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_builder_new")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_builder_new), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_builder_append")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_builder_append), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_builder_finish")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_builder_finish), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_length")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_length), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_equal")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_equal), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_compare")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_compare), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_find")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_find), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_find_char")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_find_char), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_hash")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_hash), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_to_lower")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_to_lower), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__string_to_upper")] = { llvm::orc::ExecutorAddr::fromPtr(&__string_to_upper), llvm::JITSymbolFlags::Exported };
         runtimeSymbols[JIT->mangleAndIntern("__print")] = { llvm::orc::ExecutorAddr::fromPtr(&__print), llvm::JITSymbolFlags::Exported };
         runtimeSymbols[JIT->mangleAndIntern("__println")] = { llvm::orc::ExecutorAddr::fromPtr(&__println), llvm::JITSymbolFlags::Exported };
-        runtimeSymbols[JIT->mangleAndIntern("__gc_alloc")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_alloc), llvm::JITSymbolFlags::Exported };
-        runtimeSymbols[JIT->mangleAndIntern("__gc_collect")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_collect), llvm::JITSymbolFlags::Exported };
-        runtimeSymbols[JIT->mangleAndIntern("__gc_enter_scope")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_enter_scope), llvm::JITSymbolFlags::Exported };
-        runtimeSymbols[JIT->mangleAndIntern("__gc_leave_scope")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_leave_scope), llvm::JITSymbolFlags::Exported };
-        runtimeSymbols[JIT->mangleAndIntern("__gc_pop")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_pop), llvm::JITSymbolFlags::Exported };
-        runtimeSymbols[JIT->mangleAndIntern("__gc_register")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_register), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_alloc")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_alloc : &sakuraE::runtime::__gc_alloc), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_alloc_uninit")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_alloc : &sakuraE::runtime::__gc_alloc_uninit), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_collect")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_collect : &sakuraE::runtime::__gc_collect), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_enter_scope")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_enter_scope : &sakuraE::runtime::__gc_enter_scope), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_leave_scope")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_leave_scope : &sakuraE::runtime::__gc_leave_scope), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_pop")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_pop : &sakuraE::runtime::__gc_pop), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_register")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_register : &sakuraE::runtime::__gc_register), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_write_barrier")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_write_barrier : &sakuraE::runtime::__gc_write_barrier), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_safe_point")] = { llvm::orc::ExecutorAddr::fromPtr(useArena ? &sakuraE::runtime::__arena_safe_point : &sakuraE::runtime::__gc_safe_point), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_safepoint_requested")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_safepoint_requested), llvm::JITSymbolFlags::Exported };
+        runtimeSymbols[JIT->mangleAndIntern("__gc_current_thread")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_current_thread), llvm::JITSymbolFlags::Exported };
         runtimeSymbols[JIT->mangleAndIntern("__gc_get_atomic_type")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_get_atomic_type), llvm::JITSymbolFlags::Exported };
         runtimeSymbols[JIT->mangleAndIntern("__gc_get_array_type")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_get_array_type), llvm::JITSymbolFlags::Exported };
         runtimeSymbols[JIT->mangleAndIntern("__gc_get_struct_type")] = { llvm::orc::ExecutorAddr::fromPtr(&sakuraE::runtime::__gc_get_struct_type), llvm::JITSymbolFlags::Exported };
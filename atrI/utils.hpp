@@ -87,6 +87,18 @@ namespace atri {
         }
         return false;
     }
+
+    // 查找形如 "-name=value" 的参数；找到时把 value 写入 out 并返回 true。
+    inline bool findOptionValue(std::vector<fzlib::String> arr, const std::string& prefix, std::string& out) {
+        for (auto e: arr) {
+            std::string arg = e.c_str();
+            if (arg.size() > prefix.size() && arg.compare(0, prefix.size(), prefix) == 0) {
+                out = arg.substr(prefix.size());
+                return true;
+            }
+        }
+        return false;
+    }
 }
 
 #endif // !SAKURAE_ATRI_UTILS_HPP
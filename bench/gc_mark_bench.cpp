@@ -0,0 +1,94 @@
+/*
+    SakuraE Runtime Benchmark
+    gc_mark_bench.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+// 标记阶段伸缩性基准：构造 N 个全部存活的对象（指针数组 + 小字符串），
+// 测量一次完整 __gc_collect 的耗时。地址索引是 O(1) 时，ns/object 应大致保持不变，
+// 即 mark 时间随堆大小线性增长。
+// 用法：gc_mark_bench [max_objects] [mark_threads]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "Runtime/gc.h"
+
+using namespace sakuraE::runtime;
+
+namespace {
+    constexpr uint64_t FANOUT = 1024;
+
+    double collect_ms() {
+        auto begin = std::chrono::steady_clock::now();
+        __gc_collect();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+
+    // 返回实际构造出的对象数量。
+    uint64_t build_live_heap(uint64_t target_objects, void** root) {
+        GCTypeInfo* ptr_array_ty = __gc_get_array_type(true, sizeof(void*), __gc_get_atomic_type());
+
+        uint64_t leaves = target_objects / (FANOUT + 1) + 1;
+        *root = __gc_alloc(leaves * sizeof(void*), ptr_array_ty);
+
+        uint64_t objects = 1;
+        for (uint64_t i = 0; i < leaves; ++i) {
+            void* leaf = __gc_alloc(FANOUT * sizeof(void*), ptr_array_ty);
+            static_cast<void**>(*root)[i] = leaf;
+            ++objects;
+
+            for (uint64_t j = 0; j < FANOUT; ++j) {
+                auto* str = static_cast<char*>(__gc_alloc(16, __gc_get_atomic_type()));
+                std::memcpy(str, "sakura-string", 14);
+                static_cast<void**>(static_cast<void**>(*root)[i])[j] = str;
+                ++objects;
+            }
+        }
+
+        return objects;
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t max_objects = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+    if (argc > 2) {
+        gc_set_mark_threads(static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)));
+    }
+
+    std::printf("%12s %12s %12s\n", "objects", "collect(ms)", "ns/object");
+
+    for (uint64_t target = 31'250; target <= max_objects; target *= 2) {
+        void* root = nullptr;
+
+        __gc_enter_scope();
+        __gc_register(&root);
+
+        uint64_t objects = build_live_heap(target, &root);
+
+        // 先收集一次，清掉构造过程中的临时状态，再取三次里的最小值。
+        collect_ms();
+        double best = collect_ms();
+        for (int i = 0; i < 2; ++i) {
+            double ms = collect_ms();
+            if (ms < best) {
+                best = ms;
+            }
+        }
+
+        std::printf("%12llu %12.3f %12.1f\n",
+                    static_cast<unsigned long long>(objects),
+                    best,
+                    best * 1e6 / static_cast<double>(objects));
+
+        __gc_leave_scope();
+        __gc_collect();
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+    SakuraE Runtime Benchmark
+    gc_pause_bench.cpp
+    2026-10-16
+
+    By FZSGBall
+*/
+
+// 停顿时间基准：先构造一个较大的存活堆，再持续分配短命对象，
+// 记录每次 __gc_alloc 的耗时分布。stop-the-world 模式下最长停顿随存活堆增长，
+// 增量模式下应当被限制在 pause budget 附近。
+// 用法：gc_pause_bench [live_objects] [incremental(0/1)] [pause_us]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "Runtime/gc.h"
+#include "Runtime/stats.h"
+
+using namespace sakuraE::runtime;
+
+namespace {
+    constexpr uint64_t FANOUT = 1024;
+    constexpr uint64_t CHURN_ALLOCATIONS = 4'000'000;
+
+    void build_live_heap(uint64_t target_objects, void** root) {
+        GCTypeInfo* ptr_array_ty = __gc_get_array_type(true, sizeof(void*), __gc_get_atomic_type());
+
+        uint64_t leaves = target_objects / (FANOUT + 1) + 1;
+        *root = __gc_alloc(leaves * sizeof(void*), ptr_array_ty);
+
+        for (uint64_t i = 0; i < leaves; ++i) {
+            void* leaf = __gc_alloc(FANOUT * sizeof(void*), ptr_array_ty);
+            static_cast<void**>(*root)[i] = leaf;
+            __gc_write_barrier(&static_cast<void**>(*root)[i], leaf);
+
+            for (uint64_t j = 0; j < FANOUT; ++j) {
+                auto* str = static_cast<char*>(__gc_alloc(16, __gc_get_atomic_type()));
+                std::memcpy(str, "sakura-string", 14);
+                static_cast<void**>(leaf)[j] = str;
+                __gc_write_barrier(&static_cast<void**>(leaf)[j], str);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t live_objects = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+    bool incremental = argc > 2 && std::strtoul(argv[2], nullptr, 10) != 0;
+    if (argc > 3) {
+        gc_set_pause_budget_us(static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)));
+    }
+    gc_set_incremental(incremental);
+
+    void* root = nullptr;
+    __gc_enter_scope();
+    __gc_register(&root);
+
+    build_live_heap(live_objects, &root);
+    __gc_collect();
+
+    std::vector<double> samples;
+    samples.reserve(CHURN_ALLOCATIONS);
+
+    auto total_begin = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < CHURN_ALLOCATIONS; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        __gc_alloc(32, __gc_get_atomic_type());
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+    }
+    auto total_end = std::chrono::steady_clock::now();
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) {
+        return samples[static_cast<size_t>(p * static_cast<double>(samples.size() - 1))];
+    };
+
+    std::printf("mode=%s live=%llu total=%.1fms p50=%.2fus p99=%.2fus p99.99=%.2fus max=%.2fus\n",
+                incremental ? "incremental" : "stw",
+                static_cast<unsigned long long>(live_objects),
+                std::chrono::duration<double, std::milli>(total_end - total_begin).count(),
+                percentile(0.50),
+                percentile(0.99),
+                percentile(0.9999),
+                samples.back());
+
+    // 运行时自己记录的回收停顿，不含分配本身的耗时。
+    GCStats stats = __gc_stats();
+    std::printf("gc collections=%llu slices=%llu pause_p50=%.2fus pause_p99=%.2fus pause_max=%.2fus mark=%.1fms sweep=%.1fms\n",
+                static_cast<unsigned long long>(stats.collections),
+                static_cast<unsigned long long>(stats.mark_slices),
+                static_cast<double>(stats.pause_p50_ns) / 1000.0,
+                static_cast<double>(stats.pause_p99_ns) / 1000.0,
+                static_cast<double>(stats.pause_max_ns) / 1000.0,
+                static_cast<double>(stats.mark_ns) / 1e6,
+                static_cast<double>(stats.sweep_ns) / 1e6);
+
+    __gc_leave_scope();
+    __gc_collect();
+    return 0;
+}